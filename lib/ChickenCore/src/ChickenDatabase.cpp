@@ -0,0 +1,44 @@
+#include "ChickenDatabase.h"
+#include <string.h>
+
+ChickenRegistry chickenRegistry;
+
+struct DefaultChicken {
+  TagId tagID;
+  const char* name;
+  int number;
+};
+
+// Define your actual chickens with their real tag IDs.
+// Only used until a registry has been received over MQTT (then the saved copy wins).
+static const DefaultChicken defaultChickens[] = {
+  {0x2003E98C8ULL, "Lady Kluck", 1},      // ✓ CONFIRMED - working tag
+  {0x2003EF40DULL, "Ronny", 2},           // ✓ SCANNED - new tag added
+  {0x2003F2676ULL, "Ada", 3},             // ✓ SCANNED - new tag added
+  {0x2003E98F1ULL, "Ms.Foster", 4},       // ✓ SCANNED - new tag added
+  {0x2003E586AULL, "Kiwi", 5},            // ✓ SCANNED - new tag added
+  {0x2003E956DULL, "Skrik", 6},           // ✓ SCANNED - new tag added
+  {0x200336896ULL, "Lady Klick", 7},      // ✓ SCANNED - updated name (was Panik)
+  {0x20032D5A4AULL, "Gästrid", 8},        // ✓ SCANNED - new tag added (note: 10 chars)
+  {0x2003E66AEULL, "Chick_1_2025", 9},    // ✓ SCANNED - new tag added
+  {0x2003E58C1ULL, "Chick_2_2025", 10},   // ✓ SCANNED - new tag added
+  {0x2003E609AULL, "Chick_3_2025", 11},   // ✓ SCANNED - new tag added
+  {0x2003F3CA0ULL, "Chick_4_2025", 12},   // ✓ SCANNED - new tag added
+  {0x2003E6C2FULL, "Chick_5_2025", 13},   // ✓ SCANNED - new tag added
+  {0x2003E9525ULL, "Chick_6_2025", 14},   // ✓ SCANNED - new tag added
+  {0x2003E81EEULL, "Tuppen", 15},         // ✓ SCANNED - new tag added
+  // All 15 chickens now have valid tags!
+};
+
+static_assert(sizeof(defaultChickens) / sizeof(defaultChickens[0]) <= MAX_CHICKENS, "Raise MAX_CHICKENS in ChickenRegistry.h");
+
+void loadDefaultChickens() {
+  chickenRegistry.clear();
+  for (const DefaultChicken& chicken : defaultChickens) {
+    chickenRegistry.add(chicken.tagID, chicken.number, chicken.name, strlen(chicken.name));
+  }
+}
+
+const Chicken* findChickenByTag(TagId tagID) {
+  return chickenByHandle(findChickenHandle(tagID));
+}
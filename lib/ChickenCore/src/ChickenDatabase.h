@@ -0,0 +1,27 @@
+#ifndef CHICKEN_DATABASE_H
+#define CHICKEN_DATABASE_H
+
+#include "ChickenRegistry.h"
+
+// The flock in use: loaded at boot (built-in default below, or the copy saved in flash)
+// and replaced at runtime from the registry config topic. See NestTracker.h.
+extern ChickenRegistry chickenRegistry;
+
+// Fill chickenRegistry with the flock compiled into ChickenDatabase.cpp
+void loadDefaultChickens();
+
+// Look up chicken by packed tag ID, nullptr = garbled/unknown tag.
+// O(1): hash index built when the registry is loaded.
+const Chicken* findChickenByTag(TagId tagID);
+
+// Same lookup, returning the handle (NO_CHICKEN when unknown)
+inline ChickenHandle findChickenHandle(TagId tagID) {
+  return chickenRegistry.find(tagID);
+}
+
+// nullptr for NO_CHICKEN and for numbers not in the registry
+inline const Chicken* chickenByHandle(ChickenHandle handle) {
+  return chickenRegistry.byHandle(handle);
+}
+
+#endif
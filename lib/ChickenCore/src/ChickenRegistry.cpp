@@ -0,0 +1,183 @@
+#include "ChickenRegistry.h"
+#include "Crc32.h"
+#include <string.h>
+
+// splitmix64 finalizer
+static uint32_t hashTag(TagId tag) {
+  tag = (tag ^ (tag >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  tag = (tag ^ (tag >> 27)) * 0x94D049BB133111EBULL;
+  return (uint32_t)(tag ^ (tag >> 31));
+}
+
+void ChickenRegistry::clear() {
+  for (int h = 0; h < MAX_CHICKENS; h++) {
+    chickens[h].tagID = 0;
+    chickens[h].name[0] = '\0';
+    chickens[h].number = 0;
+  }
+  for (int s = 0; s < INDEX_SLOTS; s++) index[s] = EMPTY_SLOT;
+  chickenCount = 0;
+  sourceCrc = 0;
+}
+
+bool ChickenRegistry::add(TagId tag, int number, const char* name, size_t nameLength) {
+  if (tag == 0 || (tag >> (8 * REGISTRY_TAG_BYTES)) != 0) return false;
+  if (number < 1 || number > MAX_CHICKENS) return false;
+  if (nameLength == 0 || nameLength >= CHICKEN_NAME_MAX) return false;
+
+  ChickenHandle handle = (ChickenHandle)(number - 1);
+  if (chickens[handle].number != 0) return false; // Number taken
+
+  uint32_t slot = hashTag(tag) & (INDEX_SLOTS - 1);
+  while (index[slot] != EMPTY_SLOT) {
+    if (chickens[index[slot]].tagID == tag) return false; // Tag taken
+    slot = (slot + 1) & (INDEX_SLOTS - 1);
+  }
+
+  Chicken& chicken = chickens[handle];
+  chicken.tagID = tag;
+  memcpy(chicken.name, name, nameLength);
+  chicken.name[nameLength] = '\0';
+  chicken.number = number;
+  index[slot] = handle;
+  chickenCount++;
+  return true;
+}
+
+ChickenHandle ChickenRegistry::find(TagId tag) const {
+  uint32_t slot = hashTag(tag) & (INDEX_SLOTS - 1);
+  while (index[slot] != EMPTY_SLOT) {
+    if (chickens[index[slot]].tagID == tag) return index[slot];
+    slot = (slot + 1) & (INDEX_SLOTS - 1);
+  }
+  return NO_CHICKEN; // Not found = garbled/unknown tag
+}
+
+static bool isBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+int ChickenRegistry::parse(const char* text, size_t length) {
+  clear();
+
+  int line = 0;
+  size_t pos = 0;
+  while (pos < length) {
+    line++;
+    size_t end = pos;
+    while (end < length && text[end] != '\n') end++;
+
+    // Strip comments and surrounding blanks
+    size_t stop = pos;
+    while (stop < end && text[stop] != '#') stop++;
+    while (pos < stop && isBlank(text[pos])) pos++;
+    while (stop > pos && isBlank(text[stop - 1])) stop--;
+
+    if (pos < stop) {
+      TagId tag = 0;
+      int digits = 0;
+      while (pos < stop && hexDigit(text[pos]) >= 0 && digits <= 2 * REGISTRY_TAG_BYTES) {
+        tag = (tag << 4) | (TagId)hexDigit(text[pos++]);
+        digits++;
+      }
+      if (pos == stop || !isBlank(text[pos])) {
+        clear();
+        return line;
+      }
+      while (pos < stop && isBlank(text[pos])) pos++;
+
+      int number = 0;
+      while (pos < stop && text[pos] >= '0' && text[pos] <= '9' && number <= MAX_CHICKENS) {
+        number = number * 10 + (text[pos++] - '0');
+      }
+      if (pos == stop || !isBlank(text[pos])) {
+        clear();
+        return line;
+      }
+      while (pos < stop && isBlank(text[pos])) pos++;
+
+      // The rest of the line is the name (may contain spaces)
+      if (!add(tag, number, text + pos, stop - pos)) {
+        clear();
+        return line;
+      }
+    }
+    pos = end + 1;
+  }
+
+  sourceCrc = crc32(text, length);
+  return 0;
+}
+
+size_t ChickenRegistry::serialize(uint8_t* out, size_t outSize) const {
+  // Handles sorted by tag (insertion sort: the registry is written rarely)
+  ChickenHandle order[MAX_CHICKENS];
+  int sorted = 0;
+  for (int h = 0; h < MAX_CHICKENS; h++) {
+    if (chickens[h].number == 0) continue;
+    int j = sorted++;
+    while (j > 0 && chickens[order[j - 1]].tagID > chickens[h].tagID) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = (ChickenHandle)h;
+  }
+
+  size_t used = sizeof(RegistryHeader);
+  for (int i = 0; i < sorted; i++) {
+    const Chicken& chicken = chickens[order[i]];
+    size_t nameLength = strlen(chicken.name);
+    if (used + REGISTRY_TAG_BYTES + 3 + nameLength > outSize) return 0;
+
+    for (int b = 0; b < REGISTRY_TAG_BYTES; b++) out[used++] = (uint8_t)(chicken.tagID >> (8 * b));
+    out[used++] = (uint8_t)chicken.number;
+    out[used++] = (uint8_t)(chicken.number >> 8);
+    out[used++] = (uint8_t)nameLength;
+    memcpy(out + used, chicken.name, nameLength);
+    used += nameLength;
+  }
+
+  RegistryHeader header;
+  header.magic = REGISTRY_MAGIC;
+  header.version = REGISTRY_FORMAT_VERSION;
+  header.count = (uint16_t)sorted;
+  header.source = sourceCrc;
+  header.crc = crc32(out + sizeof(header), used - sizeof(header));
+  memcpy(out, &header, sizeof(header));
+  return used;
+}
+
+bool ChickenRegistry::deserialize(const uint8_t* data, size_t length) {
+  clear();
+  if (length < sizeof(RegistryHeader)) return false;
+
+  RegistryHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != REGISTRY_MAGIC || header.version != REGISTRY_FORMAT_VERSION) return false;
+  if (crc32(data + sizeof(header), length - sizeof(header)) != header.crc) return false;
+
+  size_t pos = sizeof(header);
+  for (int i = 0; i < header.count; i++) {
+    if (pos + REGISTRY_TAG_BYTES + 3 > length) break;
+    TagId tag = 0;
+    for (int b = 0; b < REGISTRY_TAG_BYTES; b++) tag |= (TagId)data[pos++] << (8 * b);
+    int number = data[pos] | (data[pos + 1] << 8);
+    size_t nameLength = data[pos + 2];
+    pos += 3;
+    if (pos + nameLength > length || !add(tag, number, (const char*)data + pos, nameLength)) break;
+    pos += nameLength;
+  }
+  if (chickenCount != header.count || pos != length) {
+    clear();
+    return false;
+  }
+  sourceCrc = header.source;
+  return true;
+}
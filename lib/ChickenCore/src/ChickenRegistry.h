@@ -0,0 +1,96 @@
+#ifndef CHICKEN_REGISTRY_H
+#define CHICKEN_REGISTRY_H
+
+#include "El125Parser.h"
+
+// Capacity of the registry and of all per-chicken state (stats, occupancy, probe policy...).
+// Chicken numbers run 1..MAX_CHICKENS. On the ESP32 each possible chicken costs about 120 bytes
+// of shared RAM (registry entry 40, registry text/blob buffer 40, dwell histogram 20, stats
+// record buffer 16, hash index ~5: ~46 KB at 384) plus about 20 per NestTracker (stats 16,
+// leaderboard 4: ~8 KB at 384). Change via build_flags to trade RAM for flock size; the NVS
+// budget in src/main.cpp checks that the registry and stats records still fit in flash.
+#ifndef MAX_CHICKENS
+#define MAX_CHICKENS 384
+#endif
+
+#define CHICKEN_NAME_MAX 24 // Name bytes including the terminator
+
+struct Chicken {
+  TagId tagID;
+  char name[CHICKEN_NAME_MAX];
+  int number; // 0 = free registry slot
+};
+
+// Small integer handle for a chicken = its number - 1. Numbers are kept when the registry
+// changes, so stats, the visit log and queued messages keep pointing at the same bird.
+typedef uint16_t ChickenHandle;
+#define NO_CHICKEN ((ChickenHandle)0xFFFF)
+
+#define REGISTRY_MAGIC 0x47455243UL  // "CREG"
+#define REGISTRY_FORMAT_VERSION 1
+#define REGISTRY_TEXT_MAX (MAX_CHICKENS * 40) // Largest registry text accepted (MQTT config message)
+#define REGISTRY_TAG_BYTES 5         // EL125 tags are 40 bits
+
+struct RegistryHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t source; // CRC of the text the registry was parsed from (0 = built in)
+  uint32_t crc;    // Of the entries
+};
+
+// Longest binary form: header plus tag, number, name length and name per chicken
+#define REGISTRY_BLOB_MAX (sizeof(RegistryHeader) + MAX_CHICKENS * (REGISTRY_TAG_BYTES + 3 + CHICKEN_NAME_MAX - 1))
+
+constexpr int registryIndexSlots(int capacity) {
+  int slots = 8;
+  while (slots < 2 * capacity) slots *= 2; // Keep the hash index at most half full
+  return slots;
+}
+
+// The flock at runtime: tag -> chicken through an open-addressing hash index (O(1)),
+// handle -> chicken through a table indexed by number.
+//
+// Text form (MQTT config topic), one chicken per line, '#' starts a comment:
+//   <tag hex> <number> <name>
+// Binary form (flash): RegistryHeader, then per chicken, sorted by tag:
+//   5 tag bytes, 2 number bytes (little endian), name length, name bytes
+class ChickenRegistry {
+public:
+  ChickenRegistry() { clear(); }
+
+  void clear();
+
+  // false: tag/number out of range or already taken (the registry is unchanged)
+  bool add(TagId tag, int number, const char* name, size_t nameLength);
+
+  // Replace the contents from the text form. Returns 0, or the first bad line
+  // (the registry is left cleared then).
+  int parse(const char* text, size_t length);
+
+  // Binary form into out; returns the size, 0 when it does not fit
+  size_t serialize(uint8_t* out, size_t outSize) const;
+
+  // Replace the contents from the binary form; false (and cleared) when it is not valid
+  bool deserialize(const uint8_t* data, size_t length);
+
+  ChickenHandle find(TagId tag) const;
+
+  const Chicken* byHandle(ChickenHandle handle) const {
+    return handle < MAX_CHICKENS && chickens[handle].number != 0 ? &chickens[handle] : nullptr;
+  }
+
+  int count() const { return chickenCount; }
+  uint32_t source() const { return sourceCrc; }
+
+private:
+  static const int INDEX_SLOTS = registryIndexSlots(MAX_CHICKENS);
+  static const uint16_t EMPTY_SLOT = 0xFFFF;
+
+  Chicken chickens[MAX_CHICKENS]; // By handle
+  uint16_t index[INDEX_SLOTS];    // Handle or EMPTY_SLOT, probed linearly from the tag hash
+  int chickenCount;
+  uint32_t sourceCrc;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef CHICKEN_SET_H
+#define CHICKEN_SET_H
+
+#include "ChickenDatabase.h"
+
+// Fixed-size bitset of chicken handles, one bit per possible chicken number.
+// Iteration with next() skips empty words, so sparse sets stay cheap with a large MAX_CHICKENS.
+class ChickenSet {
+public:
+  ChickenSet() { clear(); }
+
+  void clear() {
+    for (int i = 0; i < WORDS; i++) bits[i] = 0;
+  }
+
+  void add(ChickenHandle handle) {
+    bits[handle / 32] |= (uint32_t)1 << (handle % 32);
+  }
+
+  void remove(ChickenHandle handle) {
+    bits[handle / 32] &= ~((uint32_t)1 << (handle % 32));
+  }
+
+  bool contains(ChickenHandle handle) const {
+    return (bits[handle / 32] >> (handle % 32)) & 1;
+  }
+
+  int count() const {
+    int total = 0;
+    for (int i = 0; i < WORDS; i++) total += __builtin_popcount(bits[i]);
+    return total;
+  }
+
+  bool empty() const {
+    for (int i = 0; i < WORDS; i++) {
+      if (bits[i]) return false;
+    }
+    return true;
+  }
+
+  // Handle of the first member at or after 'from', NO_CHICKEN when there is none.
+  // for (ChickenHandle h = set.next(0); h != NO_CHICKEN; h = set.next(h + 1)) ...
+  ChickenHandle next(int from) const {
+    for (int word = from / 32; word < WORDS; word++) {
+      uint32_t pending = bits[word];
+      if (word == from / 32) pending &= ~(uint32_t)0 << (from % 32);
+      if (pending) return (ChickenHandle)(word * 32 + __builtin_ctz(pending));
+    }
+    return NO_CHICKEN;
+  }
+
+private:
+  static const int WORDS = (MAX_CHICKENS + 31) / 32;
+  uint32_t bits[WORDS];
+};
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef CHICKEN_STATS_H
+#define CHICKEN_STATS_H
+
+// Scoring per chicken, indexed by chicken handle
+struct ChickenStats {
+  int visits;
+  unsigned long totalTime;
+  unsigned long lastVisit; // millis() of the last visit, 0 after a reboot
+  const char* name;
+};
+
+#endif
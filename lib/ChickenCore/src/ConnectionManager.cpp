@@ -0,0 +1,88 @@
+#include "ConnectionManager.h"
+
+ConnectionManager::ConnectionManager(NetworkLink& link, uint32_t seed)
+  : link(link), current(BACKOFF), stateStart(0), nextAttempt(0), streak(0), failures(0),
+    reconnects(0), connects(0), rng(seed ? seed : 0x9E3779B9) {
+}
+
+// xorshift32 - only used for backoff jitter
+uint32_t ConnectionManager::random() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+ConnectionManager::Event ConnectionManager::update(unsigned long now) {
+  switch (current) {
+    case BACKOFF:
+      if ((long)(now - nextAttempt) < 0) return NO_EVENT;
+      if (link.wifiConnected()) return attemptMqtt(now);
+      link.wifiBegin();
+      current = WIFI_CONNECTING;
+      stateStart = now;
+      return NO_EVENT;
+
+    case WIFI_CONNECTING:
+      if (link.wifiConnected()) return attemptMqtt(now);
+      if (now - stateStart > WIFI_CONNECT_TIMEOUT_MS) return fail(now);
+      return NO_EVENT;
+
+    case CONNECTED:
+    default:
+      if (link.wifiConnected() && link.mqttConnected()) return NO_EVENT;
+      // First retry right away, backoff only starts once attempts fail
+      current = BACKOFF;
+      nextAttempt = now;
+      streak = 0;
+      return DISCONNECTED;
+  }
+}
+
+unsigned long ConnectionManager::msUntilUpdate(unsigned long now) const {
+  switch (current) {
+    case BACKOFF:
+      return (long)(nextAttempt - now) <= 0 ? 0 : nextAttempt - now;
+    case WIFI_CONNECTING:
+      return WIFI_CONNECT_POLL_MS;
+    case CONNECTED:
+    default:
+      return RECONNECT_BACKOFF_MAX_MS;
+  }
+}
+
+const char* ConnectionManager::stateName(State state) {
+  switch (state) {
+    case WIFI_CONNECTING: return "wifi_connecting";
+    case CONNECTED: return "connected";
+    default: return "backoff";
+  }
+}
+
+ConnectionManager::Event ConnectionManager::attemptMqtt(unsigned long now) {
+  if (!link.mqttConnect()) return fail(now);
+  current = CONNECTED;
+  streak = 0;
+  if (connects++ > 0) reconnects++;
+  return CONNECTED_EVENT;
+}
+
+ConnectionManager::Event ConnectionManager::fail(unsigned long now) {
+  unsigned long delay = RECONNECT_BACKOFF_MAX_MS;
+  if (streak < 16) {
+    delay = (unsigned long)RECONNECT_BACKOFF_MIN_MS << streak;
+    if (delay > RECONNECT_BACKOFF_MAX_MS) delay = RECONNECT_BACKOFF_MAX_MS;
+  }
+
+  // Spread by +/- RECONNECT_JITTER_PERCENT
+  unsigned long spread = delay * RECONNECT_JITTER_PERCENT / 100;
+  if (spread > 0) {
+    delay = delay - spread + random() % (2 * spread + 1);
+  }
+
+  streak++;
+  failures++;
+  current = BACKOFF;
+  nextAttempt = now + delay;
+  return ATTEMPT_FAILED;
+}
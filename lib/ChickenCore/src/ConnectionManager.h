@@ -0,0 +1,99 @@
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include <stdint.h>
+
+#define WIFI_CONNECT_TIMEOUT_MS 10000  // Give up on one WiFi attempt after this
+#define RECONNECT_BACKOFF_MIN_MS 1000  // First retry delay
+#define RECONNECT_BACKOFF_MAX_MS 60000 // Retry delay cap
+#define RECONNECT_JITTER_PERCENT 25    // +/- random spread so several nests don't retry in lockstep
+#define WIFI_CONNECT_POLL_MS 100       // WiFi status checks while associating
+
+// The network operations the connection manager drives
+class NetworkLink {
+public:
+  virtual ~NetworkLink() {}
+  virtual void wifiBegin() = 0;        // Start (or restart) a WiFi association, must not wait
+  virtual bool wifiConnected() = 0;
+  virtual bool mqttConnect() = 0;      // One connect attempt
+  virtual bool mqttConnected() = 0;
+};
+
+// WiFi/MQTT reconnect state machine with jittered exponential backoff.
+// update() never waits; call it from the task that owns the network client.
+class ConnectionManager {
+public:
+  enum State {
+    BACKOFF,          // Waiting for the next attempt
+    WIFI_CONNECTING,  // WiFi association in progress
+    CONNECTED         // WiFi and MQTT up
+  };
+
+  enum Event {
+    NO_EVENT,
+    CONNECTED_EVENT,  // MQTT (re)connected during this update()
+    DISCONNECTED,     // Connection lost during this update()
+    ATTEMPT_FAILED    // An attempt failed, next one at retryAt()
+  };
+
+  ConnectionManager(NetworkLink& link, uint32_t seed);
+
+  Event update(unsigned long now);
+
+  // How long the owner may wait before the next update() while not connected
+  // (0 = now). Connected links are checked on the owner's own keepalive cadence.
+  unsigned long msUntilUpdate(unsigned long now) const;
+
+  State state() const { return current; }
+  static const char* stateName(State state); // "backoff", "wifi_connecting", "connected"
+  bool connected() const { return current == CONNECTED; }
+  unsigned long retryAt() const { return nextAttempt; }
+  uint32_t reconnectCount() const { return reconnects; }   // Successful connects after the first
+  uint32_t failedAttempts() const { return failures; }     // All failed attempts since boot
+  uint32_t consecutiveFailures() const { return streak; }
+
+private:
+  Event attemptMqtt(unsigned long now);
+  Event fail(unsigned long now);
+  uint32_t random();
+
+  NetworkLink& link;
+  State current;
+  unsigned long stateStart;
+  unsigned long nextAttempt;
+  uint32_t streak;
+  uint32_t failures;
+  uint32_t reconnects;
+  uint32_t connects;
+  uint32_t rng;
+};
+
+// When an MQTT client that pings from its loop() (PubSubClient) next needs that loop() to run.
+// The client sends a PINGREQ once keepaliveMs passed since its last packet in or out, and then
+// counts both from the ping. Stamp packets here after the client did, so these times trail its
+// own and msUntilPing() never ends before the client considers the ping due.
+class KeepaliveClock {
+public:
+  explicit KeepaliveClock(unsigned long keepaliveMs) : period(keepaliveMs) {}
+
+  void connected(unsigned long now) { lastOut = lastIn = now; }
+  void sent(unsigned long now) { lastOut = now; }
+  void received(unsigned long now) { lastIn = now; }
+
+  // Checked right before the client's loop(): true means that loop() pings, then call pinged()
+  bool pingDue(unsigned long now) const { return now - lastOut > period || now - lastIn > period; }
+  void pinged(unsigned long now) { lastOut = lastIn = now; }
+
+  // Time until pingDue() (also the client's reply deadline while a ping is outstanding)
+  unsigned long msUntilPing(unsigned long now) const {
+    unsigned long elapsed = now - lastOut > now - lastIn ? now - lastOut : now - lastIn;
+    return elapsed > period ? 0 : period - elapsed + 1;
+  }
+
+private:
+  unsigned long period;
+  unsigned long lastOut = 0;
+  unsigned long lastIn = 0;
+};
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-32 (IEEE 802.3, reflected, same as zlib). Pass the previous result to continue a running CRC.
+uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+
+#endif
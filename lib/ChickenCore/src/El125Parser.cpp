@@ -0,0 +1,116 @@
+#include "El125Parser.h"
+#include <stdio.h>
+
+static int hexValue(uint8_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+El125Parser::El125Parser()
+  : state(WAIT_STX), length(0), overflow(false), lastTag(0), accepted(0), rejected(0) {
+}
+
+void El125Parser::reset() {
+  state = WAIT_STX;
+  length = 0;
+  overflow = false;
+}
+
+El125Parser::Result El125Parser::feed(uint8_t byte) {
+  if (byte == EL125_STX) {
+    // A new STX always restarts the frame - a previous frame without ETX was truncated
+    Result result = (state == IN_FRAME && length > 0) ? REJECTED : NONE;
+    if (result == REJECTED) rejected++;
+    state = IN_FRAME;
+    length = 0;
+    overflow = false;
+    return result;
+  }
+
+  if (state != IN_FRAME) {
+    return NONE; // Line noise between frames
+  }
+
+  if (byte == EL125_ETX) {
+    state = WAIT_STX;
+    return finishFrame();
+  }
+
+  // Some readers add CR/LF inside the frame - skip anything that isn't a hex digit
+  if (hexValue(byte) < 0) {
+    return NONE;
+  }
+
+  if (length < EL125_PAYLOAD_MAX) {
+    payload[length++] = byte;
+  } else {
+    overflow = true;
+  }
+  return NONE;
+}
+
+El125Parser::Result El125Parser::finishFrame() {
+  uint8_t len = length;
+  length = 0;
+
+  if (overflow || len == 0) {
+    rejected++;
+    return REJECTED;
+  }
+
+#if EL125_VERIFY_CHECKSUM
+  // 10 data digits, optionally followed by the 2 checksum digits
+  if (len != EL125_DATA_LEN && len != EL125_PAYLOAD_LEN) {
+    rejected++;
+    return REJECTED;
+  }
+#endif
+
+  // Pack the data digits only: the checksum is not part of the ID (database IDs are 40 bits)
+  uint8_t dataLen = len == EL125_PAYLOAD_LEN ? EL125_DATA_LEN : len;
+  TagId tag = 0;
+  for (uint8_t i = 0; i < dataLen; i++) {
+    tag = (tag << 4) | (TagId)hexValue(payload[i]);
+  }
+
+#if EL125_VERIFY_CHECKSUM
+  if (len == EL125_PAYLOAD_LEN) {
+    uint8_t expected = (uint8_t)((hexValue(payload[EL125_DATA_LEN]) << 4) | hexValue(payload[EL125_DATA_LEN + 1]));
+    if (el125Checksum(tag) != expected) {
+      rejected++;
+      return REJECTED;
+    }
+  }
+#endif
+
+  // Same rule as the old text parser: an all-zero ID is noise
+  if (tag == 0) {
+    rejected++;
+    return REJECTED;
+  }
+
+  lastTag = tag;
+  accepted++;
+  return FRAME;
+}
+
+uint8_t el125Checksum(TagId tag) {
+  uint8_t checksum = 0;
+  for (int i = 0; i < EL125_DATA_LEN / 2; i++) checksum ^= (uint8_t)(tag >> (8 * i));
+  return checksum;
+}
+
+size_t encodeEl125Frame(TagId tag, uint8_t* out) {
+  char digits[EL125_PAYLOAD_LEN + 1];
+  snprintf(digits, sizeof(digits), "%0*llX%02X", EL125_DATA_LEN, (unsigned long long)tag, el125Checksum(tag));
+  out[0] = EL125_STX;
+  for (int i = 0; i < EL125_PAYLOAD_LEN; i++) out[1 + i] = (uint8_t)digits[i];
+  out[EL125_FRAME_LEN - 1] = EL125_ETX;
+  return EL125_FRAME_LEN;
+}
+
+void formatTagID(TagId tag, char* out, size_t outSize) {
+  snprintf(out, outSize, "%08llX", (unsigned long long)tag);
+}
@@ -0,0 +1,70 @@
+#ifndef EL125_PARSER_H
+#define EL125_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// EL125 UART frame: STX(0x02) + 10 ASCII hex data chars + 2 ASCII hex checksum chars + ETX(0x03)
+// The checksum is the XOR of the 5 data bytes. Frames with the 10 data chars only are accepted too.
+#define EL125_STX 0x02
+#define EL125_ETX 0x03
+#define EL125_DATA_LEN 10      // Version byte + 32-bit card number, as hex chars
+#define EL125_PAYLOAD_LEN 12   // 10 data + 2 checksum hex chars
+#define EL125_FRAME_LEN (EL125_PAYLOAD_LEN + 2)
+#define EL125_PAYLOAD_MAX 16   // Longest payload we buffer before giving up on a frame
+
+// Set to 0 via build_flags (-DEL125_VERIFY_CHECKSUM=0) to accept frames with a bad checksum or length
+#ifndef EL125_VERIFY_CHECKSUM
+#define EL125_VERIFY_CHECKSUM 1
+#endif
+
+// Packed tag ID: the data hex digits read as one integer (0 = no tag), without the checksum.
+// This keeps the numeric value identical to the old text IDs: frame "02003E98C8" "6C" == 0x2003E98C8.
+typedef uint64_t TagId;
+
+// Buffer size needed by formatTagID() ("%08llX" of a 16-digit payload + NUL)
+#define TAG_TEXT_LEN 17
+
+// Incremental, non-blocking EL125 frame decoder. Feed it one byte at a time;
+// it never allocates and never waits for more data.
+class El125Parser {
+public:
+  enum Result {
+    NONE,      // Byte consumed, no frame completed yet
+    FRAME,     // Valid frame completed, tag() holds the ID
+    REJECTED   // Frame completed but failed validation (length/checksum/garbage)
+  };
+
+  El125Parser();
+
+  Result feed(uint8_t byte);
+  void reset();
+
+  TagId tag() const { return lastTag; }
+  uint32_t framesAccepted() const { return accepted; }
+  uint32_t framesRejected() const { return rejected; }
+
+private:
+  enum State { WAIT_STX, IN_FRAME };
+
+  Result finishFrame();
+
+  State state;
+  uint8_t payload[EL125_PAYLOAD_MAX];
+  uint8_t length;
+  bool overflow;
+  TagId lastTag;
+  uint32_t accepted;
+  uint32_t rejected;
+};
+
+// XOR of the 5 data bytes, as sent in the last two payload digits
+uint8_t el125Checksum(TagId tag);
+
+// The EL125_FRAME_LEN bytes a reader sends for tag (replay traces, benchmarks, tests)
+size_t encodeEl125Frame(TagId tag, uint8_t* out);
+
+// Format a packed tag ID as upper-case hex text, zero-padded to 8 digits like the old extractTagID()
+void formatTagID(TagId tag, char* out, size_t outSize);
+
+#endif
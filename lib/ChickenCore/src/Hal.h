@@ -0,0 +1,115 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Thin hardware abstraction for the tracking logic.
+// The ESP32 firmware implements these on top of millis()/HardwareSerial/GPIO/PubSubClient,
+// the native build implements them on top of the host OS so the same code runs on Linux.
+
+class HalClock {
+public:
+  virtual ~HalClock() {}
+  virtual unsigned long millis() = 0;
+  virtual void delay(unsigned long ms) = 0;
+  // Microseconds for timing measurements (wraps), millisecond resolution unless overridden
+  virtual unsigned long micros() { return millis() * 1000UL; }
+  // Unix time in seconds, 0 while the wall clock is not set (no NTP yet)
+  virtual uint32_t epochSeconds() { return 0; }
+};
+
+// Byte source for the EL125 UART
+class HalUart {
+public:
+  virtual ~HalUart() {}
+  virtual int available() = 0;
+  virtual int read() = 0;
+};
+
+// EL125 RES pin (active low)
+class HalResetPin {
+public:
+  virtual ~HalResetPin() {}
+  virtual void write(bool high) = 0;
+};
+
+// Outcome of the messages published with one receipt, counted in publish order by whoever
+// sends them. After a failure nothing more with that receipt is sent (it is counted as failed)
+// until the owner clears blocked, so delivered always covers a prefix of what was handed over.
+struct DeliveryReceipt {
+  std::atomic<uint32_t> delivered{0};
+  std::atomic<uint32_t> failed{0};
+  std::atomic<bool> blocked{false};
+};
+
+// MQTT-style publisher
+class HalPublisher {
+public:
+  virtual ~HalPublisher() {}
+  virtual bool connected() = 0;
+  virtual bool publish(const char* topic, const char* payload) = 0;
+  // Binary payload (compact wire format), may contain NUL bytes
+  virtual bool publish(const char* topic, const uint8_t* payload, size_t length) = 0;
+
+  // Publish a message that must not be lost (outbox visits/changes). false = not taken,
+  // nothing reported. true = the outcome is (or will be) counted in receipt; a publisher
+  // that only queues the message reports it once it was actually sent.
+  virtual bool publishConfirmed(const char* topic, const uint8_t* payload, size_t length, bool binary,
+                                DeliveryReceipt& receipt) {
+    bool sent = binary ? publish(topic, payload, length) : publish(topic, (const char*)payload);
+    if (sent) receipt.delivered.fetch_add(1);
+    return sent;
+  }
+};
+
+// Line-oriented debug output
+class HalLog {
+public:
+  virtual ~HalLog() {}
+  virtual void println(const char* line) = 0;
+};
+
+// Small key/value blobs that survive a reboot (NVS on the ESP32)
+class HalStorage {
+public:
+  virtual ~HalStorage() {}
+  // Copy the stored value into data, returns its length (0 = missing or larger than size)
+  virtual size_t load(const char* key, void* data, size_t size) = 0;
+  virtual bool save(const char* key, const void* data, size_t size) = 0;
+};
+
+// Counters kept outside the tracking code (acquisition task, network task, platform).
+// All cumulative; leave a field 0 when the platform can't provide it.
+struct PlatformDiagnostics {
+  uint32_t framesReceived;     // Frames decoded by an acquisition task owning the UART
+  uint32_t framesRejected;     // Frames failing the EL125 checks there
+  uint32_t framesDropped;      // Frames lost between acquisition and tracking
+  uint32_t uartOverflows;      // UART RX buffer/FIFO overruns
+  uint32_t publishFailures;    // Publishes the transport refused or lost
+  const char* connectionState; // ConnectionManager::stateName(), nullptr = no connection manager
+  uint32_t reconnects;         // Successful connects after the first
+  uint32_t connectFailures;    // Failed WiFi/MQTT attempts since boot
+  uint32_t freeHeap;
+  uint32_t minFreeHeap;
+  uint32_t largestFreeBlock;
+};
+
+class HalDiagnostics {
+public:
+  virtual ~HalDiagnostics() {}
+  virtual void collect(PlatformDiagnostics& out) = 0;
+};
+
+struct Hal {
+  HalClock* clock;
+  HalUart* uart;
+  HalResetPin* resetPin;
+  HalPublisher* publisher;
+  HalLog* log;
+  HalStorage* storage; // nullptr = nothing is persisted
+  HalDiagnostics* diagnostics; // nullptr = no platform counters
+};
+
+#endif
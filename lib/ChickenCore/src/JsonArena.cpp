@@ -0,0 +1,59 @@
+#include "JsonArena.h"
+#include <string.h>
+
+void* JsonArena::allocate(size_t size) {
+  size_t needed = align(sizeof(Block)) + align(size);
+  if (used + needed > sizeof(buffer)) {
+    overflows++;
+    return nullptr;
+  }
+
+  Block* block = (Block*)(buffer + used);
+  block->size = size;
+  used += needed;
+  if (used > peak) peak = used;
+  live++;
+  last = (uint8_t*)block + align(sizeof(Block));
+  return last;
+}
+
+void JsonArena::deallocate(void* pointer) {
+  if (!pointer) return;
+  if (pointer == last) {
+    // Give the tail back so a realloc-heavy document doesn't creep through the arena
+    used = (uint8_t*)blockOf(pointer) - buffer;
+    last = nullptr;
+  }
+  if (--live == 0) {
+    used = 0; // Document gone: start over
+    last = nullptr;
+  }
+}
+
+void* JsonArena::reallocate(void* pointer, size_t newSize) {
+  if (!pointer) return allocate(newSize);
+
+  Block* block = blockOf(pointer);
+  if (pointer == last) {
+    size_t start = (uint8_t*)pointer - buffer;
+    if (start + align(newSize) > sizeof(buffer)) {
+      overflows++;
+      return nullptr;
+    }
+    block->size = newSize;
+    used = start + align(newSize);
+    if (used > peak) peak = used;
+    return pointer;
+  }
+
+  if (newSize <= block->size) {
+    block->size = newSize; // Shrinking an older block: keep it where it is
+    return pointer;
+  }
+
+  void* moved = allocate(newSize);
+  if (!moved) return nullptr;
+  memcpy(moved, pointer, block->size);
+  deallocate(pointer);
+  return moved;
+}
@@ -0,0 +1,42 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// ArduinoJson allocator on a fixed static buffer, so building a payload never touches the heap.
+// Payloads are built one at a time on the tracker task: allocations are bumped off the buffer
+// and the whole arena is reused as soon as the last block of a document is released.
+// Running out of space makes the document report overflowed() instead of falling back to malloc.
+
+#ifndef JSON_ARENA_SIZE
+#define JSON_ARENA_SIZE (sizeof(void*) > 4 ? 8192 : 4096) // ArduinoJson pools and slots double on 64-bit hosts
+#endif
+
+class JsonArena : public ArduinoJson::Allocator {
+public:
+  void* allocate(size_t size) override;
+  void deallocate(void* pointer) override;
+  void* reallocate(void* pointer, size_t newSize) override;
+
+  size_t highWater() const { return peak; }           // Most bytes ever in use
+  uint32_t overflowCount() const { return overflows; } // Allocations refused for lack of space
+
+private:
+  struct Block {
+    size_t size; // Payload bytes following this header
+  };
+
+  static size_t align(size_t size) { return (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1); }
+  Block* blockOf(void* pointer) { return (Block*)((uint8_t*)pointer - align(sizeof(Block))); }
+
+  alignas(max_align_t) uint8_t buffer[JSON_ARENA_SIZE];
+  size_t used = 0;
+  size_t peak = 0;
+  int live = 0;
+  void* last = nullptr; // Most recent block, the only one that can grow in place
+  uint32_t overflows = 0;
+};
+
+#endif
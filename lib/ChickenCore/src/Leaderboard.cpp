@@ -0,0 +1,52 @@
+#include "Leaderboard.h"
+
+void Leaderboard::rebuild(const ChickenStats* statsArray, int chickenCount) {
+  stats = statsArray;
+  count = chickenCount > MAX_CHICKENS ? MAX_CHICKENS : chickenCount;
+
+  // Insertion sort, stable so ties stay in database order
+  for (int i = 0; i < count; i++) {
+    int j = i;
+    while (j > 0 && stats[order[j - 1]].visits < stats[i].visits) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = (ChickenHandle)i;
+  }
+  for (int i = 0; i < count; i++) {
+    rank[order[i]] = (uint16_t)i;
+    touch(order[i]);
+  }
+}
+
+void Leaderboard::touch(ChickenHandle chicken) {
+  // Only entries in (or leaving) the published ranks matter to subscribers
+  if (ranked(chicken) || published.contains(chicken)) {
+    dirty.add(chicken);
+  }
+}
+
+void Leaderboard::update(ChickenHandle chicken) {
+  if (!stats || chicken >= count) return;
+
+  // Move up past everyone with fewer visits; each one overtaken drops a rank
+  int position = rank[chicken];
+  while (position > 0 && stats[order[position - 1]].visits < stats[chicken].visits) {
+    ChickenHandle overtaken = order[position - 1];
+    order[position] = overtaken;
+    rank[overtaken] = (uint16_t)position;
+    touch(overtaken);
+    position--;
+  }
+  order[position] = chicken;
+  rank[chicken] = (uint16_t)position;
+  touch(chicken);
+}
+
+void Leaderboard::markPublished() {
+  published.clear();
+  for (int i = 0; i < LEADERBOARD_SIZE && i < count; i++) {
+    if (ranked(order[i])) published.add(order[i]);
+  }
+  dirty.clear();
+}
@@ -0,0 +1,44 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include "ChickenDatabase.h"
+#include "ChickenSet.h"
+#include "ChickenStats.h"
+
+#define LEADERBOARD_SIZE 10 // Ranks published
+
+// Chickens ranked by visit count, kept sorted as visits come in.
+// Visits only ever grow, so a visit moves one chicken up past the ones it overtook
+// instead of re-sorting the whole flock. Remembers which ranks changed since the
+// last publish so only those have to be sent.
+class Leaderboard {
+public:
+  // Full sort, e.g. after the stats were restored at boot
+  void rebuild(const ChickenStats* stats, int count);
+
+  // stats[chicken].visits (and its time) just went up
+  void update(ChickenHandle chicken);
+
+  ChickenHandle at(int rank) const { return rank < count ? order[rank] : NO_CHICKEN; } // 0-based
+  int rankOf(ChickenHandle chicken) const { return rank[chicken]; }
+  const ChickenStats& statsOf(ChickenHandle chicken) const { return stats[chicken]; }
+  bool ranked(ChickenHandle chicken) const { return rank[chicken] < LEADERBOARD_SIZE && stats[chicken].visits > 0; }
+
+  // Chickens whose published entry is out of date: moved, or visited while in the top ranks,
+  // or dropped out of them. Cleared by markPublished().
+  const ChickenSet& changed() const { return dirty; }
+  bool wasPublished(ChickenHandle chicken) const { return published.contains(chicken); }
+  void markPublished();
+
+private:
+  void touch(ChickenHandle chicken);
+
+  const ChickenStats* stats = nullptr;
+  int count = 0;
+  ChickenHandle order[MAX_CHICKENS]; // Handles, most visits first
+  uint16_t rank[MAX_CHICKENS];       // Inverse of order[]
+  ChickenSet dirty;
+  ChickenSet published;              // Chickens in the last published top ranks
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef LOG_LEVEL_H
+#define LOG_LEVEL_H
+
+// Compile-time log levels for the tracking code. A call above TRACKER_LOG_LEVEL becomes an
+// if (constant) the compiler drops as dead code: its arguments are never evaluated or formatted,
+// and with optimization on its format string is not kept either.
+// Production builds: -DTRACKER_LOG_LEVEL=3 (info); 0 removes logging entirely.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1   // Something failed (storage, rejected config)
+#define LOG_LEVEL_WARN 2    // Unexpected input that is handled (unknown tags)
+#define LOG_LEVEL_INFO 3    // One line per event: enter, exit, change, registry, restore
+#define LOG_LEVEL_DEBUG 4   // Per-read detail, banners, every MQTT payload
+
+#ifndef TRACKER_LOG_LEVEL
+#define TRACKER_LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Leveled calls of the enclosing class's printf-style log()
+#define LOG_AT(level, ...) do { if ((level) <= TRACKER_LOG_LEVEL) log(__VA_ARGS__); } while (0)
+#define LOGE(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOGW(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOGI(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOGD(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#endif
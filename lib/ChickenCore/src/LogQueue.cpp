@@ -0,0 +1,12 @@
+#include "LogQueue.h"
+#include <stdio.h>
+
+void QueuedLog::println(const char* line) {
+  LogLine* slot = ring.acquire();
+  if (!slot) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  snprintf(slot->text, sizeof(slot->text), "%s", line);
+  ring.commit();
+}
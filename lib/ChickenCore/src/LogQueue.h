@@ -0,0 +1,33 @@
+#ifndef LOG_QUEUE_H
+#define LOG_QUEUE_H
+
+#include "Hal.h"
+#include "SpscRing.h"
+#include <atomic>
+
+#define LOG_LINE_MAX 192   // Same as the line NestTracker::log() formats
+#define LOG_QUEUE_SIZE 32
+
+struct LogLine {
+  char text[LOG_LINE_MAX];
+};
+
+typedef SpscRing<LogLine, LOG_QUEUE_SIZE> LogRing;
+
+// HalLog for the tracker task: println() copies the formatted line into a lock-free ring
+// that a low-priority task writes to the console. Never blocks; drops lines when full.
+class QueuedLog : public HalLog {
+public:
+  explicit QueuedLog(LogRing& ring) : ring(ring), dropped(0) {}
+
+  void println(const char* line) override;
+
+  // Lines lost to a full ring since the last call (for the writer to report)
+  uint32_t takeDropped() { return dropped.exchange(0, std::memory_order_relaxed); }
+
+private:
+  LogRing& ring;
+  std::atomic<uint32_t> dropped;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+// Runtime instrumentation for the tracking code, published on the system metrics topic
+
+#define LATENCY_BUCKETS 12           // Bucket 0: < 64 us, bucket i: < 64 << i us, last: everything slower
+#define LATENCY_FIRST_BUCKET_US 64
+
+// Log2 histogram of durations in microseconds
+class LatencyHistogram {
+public:
+  LatencyHistogram() { reset(); }
+
+  void record(uint32_t us) {
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && us >= ((uint32_t)LATENCY_FIRST_BUCKET_US << bucket)) bucket++;
+    buckets[bucket]++;
+    samples++;
+    if (us > longest) longest = us;
+  }
+
+  void reset() {
+    for (int i = 0; i < LATENCY_BUCKETS; i++) buckets[i] = 0;
+    samples = 0;
+    longest = 0;
+  }
+
+  uint32_t bucket(int i) const { return buckets[i]; }
+  uint32_t count() const { return samples; }
+  uint32_t max() const { return longest; }
+
+private:
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t samples;
+  uint32_t longest;
+};
+
+// Counters kept by the tracking code. Histograms cover one publish interval, counters are totals.
+struct TrackingMetrics {
+  LatencyHistogram updateTime;  // NestTracker::update() passes (the tracker's loop)
+  LatencyHistogram handleTime;  // NestTracker::handleTag() per frame
+  uint32_t framesHandled;       // Frames passed to NestTracker::handleTag()
+  uint32_t staleFrames;         // Dropped because they were read during a reader reset
+  uint32_t unknownTags;         // Valid frames whose tag is not in the database
+  uint32_t resets;              // Reader resets started
+  uint32_t resetBusyMs;         // Time the reader spent resetting/settling (no fresh reads)
+  uint32_t exits;               // Exits detected by a presence probe
+  uint32_t exitLatencyTotalS;   // Sum over exits of (exit declared - chicken last read)
+  uint32_t exitLatencyMaxS;
+};
+
+#endif
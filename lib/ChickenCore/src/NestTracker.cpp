@@ -0,0 +1,1184 @@
+#include "NestTracker.h"
+#include "ChickenSet.h"
+#include "JsonArena.h"
+#include "PublishQueue.h"
+#include "Crc32.h"
+#include "LogLevel.h"
+#include <ArduinoJson.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Payloads are built and serialized here, one at a time, so publishing never allocates.
+// Shared by all nests: they run on the same task.
+JsonArena jsonArena;
+static char payload[PUBLISH_PAYLOAD_MAX];
+
+// How often occupied nests are probed; visit lengths are learned per chicken, whichever nest
+static PresencePolicy presencePolicy;
+
+// Wire format per high-rate topic, for all nests
+static NestTracker::PayloadFormat payloadFormats[NestTracker::PAYLOAD_TOPICS];
+
+// Every nest that began, for the registry update (applied only while all of them are empty)
+static NestTracker* nests = nullptr;
+static int nestCount = 0;
+
+// Registry text received on the network task, waiting for the tracker (nests empty) to apply it.
+// The buffer then holds the binary form written to storage.
+#define REGISTRY_BUFFER_SIZE (REGISTRY_BLOB_MAX > REGISTRY_TEXT_MAX ? REGISTRY_BLOB_MAX : REGISTRY_TEXT_MAX)
+static uint8_t registryBuffer[REGISTRY_BUFFER_SIZE];
+static std::atomic<size_t> registryPending(0); // Text length, 0 = buffer free
+static std::atomic<uint32_t> registrySource(0); // chickenRegistry.source(), readable from any task
+static bool registryLoaded = false;
+
+void NestTracker::initTopics() {
+  // Compose like: chickens/nest<tag>/...
+  snprintf(topicNestStatus, sizeof(topicNestStatus), "chickens/nest%s/status", nestTag);
+  snprintf(topicNestOccupant, sizeof(topicNestOccupant), "chickens/nest%s/occupant", nestTag);
+  snprintf(topicNestOccupants, sizeof(topicNestOccupants), "chickens/nest%s/occupants", nestTag);
+  snprintf(topicNestDuration, sizeof(topicNestDuration), "chickens/nest%s/duration", nestTag);
+  // Per-nest visit/change/leaderboard topics to avoid cross-device collisions
+  snprintf(topicChickenVisits, sizeof(topicChickenVisits), "chickens/nest%s/visits", nestTag);
+  snprintf(topicChickenLeaderboard, sizeof(topicChickenLeaderboard), "chickens/nest%s/leaderboard", nestTag);
+  snprintf(topicChickenLeaderboardDelta, sizeof(topicChickenLeaderboardDelta), "chickens/nest%s/leaderboard/delta", nestTag);
+  snprintf(topicLeaderboardRequest, sizeof(topicLeaderboardRequest), "chickens/nest%s/leaderboard/get", nestTag);
+  snprintf(topicChickenChanges, sizeof(topicChickenChanges), "chickens/nest%s/changes", nestTag);
+  snprintf(topicVisitHistory, sizeof(topicVisitHistory), "chickens/nest%s/visits/history", nestTag);
+  snprintf(topicVisitHistoryRequest, sizeof(topicVisitHistoryRequest), "chickens/nest%s/visits/get", nestTag);
+  snprintf(topicSystemStatus, sizeof(topicSystemStatus), "chickens/nest%s/system/status", nestTag);
+  snprintf(topicSystemMetrics, sizeof(topicSystemMetrics), "chickens/nest%s/system/metrics", nestTag);
+
+  state.setTopic(STATE_STATUS, topicNestStatus);
+  state.setTopic(STATE_OCCUPANT, topicNestOccupant);
+  state.setTopic(STATE_OCCUPANTS, topicNestOccupants);
+  state.setTopic(STATE_DURATION, topicNestDuration, true); // Sent for every visit, even equal ones
+}
+
+// printf-style debug line, prefixed with the nest tag when a board serves several nests
+void NestTracker::log(const char* format, ...) const {
+  char line[192];
+  int used = nestCount > 1 ? snprintf(line, sizeof(line), "[%s] ", nestTag) : 0;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line + used, sizeof(line) - used, format, args);
+  va_end(args);
+  hal.log->println(line);
+}
+
+// Serialize into the shared payload buffer, returning the length
+static size_t serializePayload(const JsonDocument& doc, HalLog* log,
+                               NestTracker::PayloadFormat format = NestTracker::JSON) {
+  if (doc.overflowed()) {
+    char line[64];
+    snprintf(line, sizeof(line), "✗ JSON arena full (%u bytes), payload truncated", (unsigned)JSON_ARENA_SIZE);
+    log->println(line);
+  }
+  if (format == NestTracker::MSGPACK) return serializeMsgPack(doc, payload, sizeof(payload));
+  return serializeJson(doc, payload, sizeof(payload));
+}
+
+// Publish what serializePayload() left in the shared buffer
+bool NestTracker::publishPayload(const char* topic, size_t length, PayloadFormat format, DeliveryReceipt* receipt) {
+  if (receipt) return hal.publisher->publishConfirmed(topic, (const uint8_t*)payload, length, format == MSGPACK, *receipt);
+  if (format == MSGPACK) return hal.publisher->publish(topic, (const uint8_t*)payload, length);
+  return hal.publisher->publish(topic, payload);
+}
+
+
+// Function to get chicken info string ("N (Name)")
+static const char* getChickenInfo(const Chicken* chicken, char* out, size_t outSize) {
+  if (chicken != nullptr) {
+    snprintf(out, outSize, "%d (%s)", chicken->number, chicken->name);
+  } else {
+    snprintf(out, outSize, "UNKNOWN");
+  }
+  return out;
+}
+
+// Build the comma-separated list of chickens in the nest
+void NestTracker::buildChickenList(char* out, size_t outSize, const char* separator) const {
+  const ChickenSet& present = occupancy.present();
+  size_t used = 0;
+  out[0] = '\0';
+  for (ChickenHandle h = present.next(0); h != NO_CHICKEN && used < outSize; h = present.next(h + 1)) {
+    int n = snprintf(out + used, outSize - used, "%s%s", used > 0 ? separator : "", chickenByHandle(h)->name);
+    if (n < 0) break;
+    used += n;
+  }
+}
+
+// Function to publish nest status
+void NestTracker::publishNestStatus(const char* status, ChickenHandle occupantHandle, int duration) {
+  if (!hal.publisher->connected()) return;
+
+  char chickenList[256];
+  const ChickenSet& present = occupancy.present();
+  const Chicken* chicken = chickenByHandle(occupantHandle);
+  const char* occupant = chicken ? chicken->name : "";
+  bool multiple = strcmp(status, "multiple") == 0 && !present.empty();
+  if (multiple) {
+    // Comma-separated list for the occupant field and topic
+    buildChickenList(chickenList, sizeof(chickenList), ", ");
+    occupant = chickenList; // Update occupant for the separate topic
+  }
+
+  JsonDocument doc(&jsonArena);
+  PayloadFormat format = payloadFormats[STATUS];
+  if (format == MSGPACK) {
+    JsonArray fields = doc.to<JsonArray>();
+    fields.add(status);
+    fields.add(millis());
+    fields.add(duration);
+    JsonArray numbers = fields.add<JsonArray>();
+    JsonArray confidence = fields.add<JsonArray>();
+    if (multiple) {
+      for (ChickenHandle h = present.next(0); h != NO_CHICKEN; h = present.next(h + 1)) {
+        numbers.add(chickenByHandle(h)->number);
+        confidence.add(occupancy.confidence(h, millis()));
+      }
+    } else if (chicken) {
+      numbers.add(chicken->number);
+    }
+  } else {
+    doc["status"] = status;
+    doc["timestamp"] = millis();
+
+    if (occupant[0] != '\0') {
+      doc["occupant"] = occupant;
+    }
+
+    // If multiple chickens detected, add the specific chicken list
+    if (multiple) {
+      JsonArray chickens = doc["chickens"].to<JsonArray>();
+      JsonArray confidence = doc["confidence"].to<JsonArray>(); // Percent, same order as chickens
+      for (ChickenHandle h = present.next(0); h != NO_CHICKEN; h = present.next(h + 1)) {
+        chickens.add(chickenByHandle(h)->name);
+        confidence.add(occupancy.confidence(h, millis()));
+      }
+      doc["chicken_count"] = present.count();
+    }
+
+    if (duration > 0) {
+      doc["duration"] = duration;
+    }
+  }
+
+  size_t length = serializePayload(doc, hal.log, format);
+
+  // The timestamp and read confidence change with every call: only status, occupant and
+  // duration decide whether the status topic is sent again
+  uint32_t key = crc32(status, strlen(status));
+  key = crc32(occupant, strlen(occupant), key);
+  key = crc32(&duration, sizeof(duration), key);
+  state.set(STATE_STATUS, payload, length, format == MSGPACK, key);
+  state.set(STATE_OCCUPANT, occupant);
+
+  // NEW: Also publish simple occupants format
+  publishSimpleOccupants();
+
+  if (duration > 0) {
+    char durationText[16];
+    snprintf(durationText, sizeof(durationText), "%d", duration);
+    state.set(STATE_DURATION, durationText);
+  }
+}
+
+// Send the nest state topics that changed during this pass, each once
+void NestTracker::flushState() {
+  uint32_t sent = state.flush(hal.publisher);
+  if (sent == 0) return;
+
+  LOGD("MQTT Published:");
+  for (int slot = 0; slot < STATE_SLOTS; slot++) {
+    if (!(sent & (1UL << slot))) continue;
+    if (state.binary(slot)) {
+      LOGD("  Topic: %s | Payload: %u bytes MessagePack", state.topic(slot), (unsigned)state.length(slot));
+    } else {
+      LOGD("  Topic: %s | Payload: %s", state.topic(slot), state.value(slot));
+    }
+  }
+}
+
+// Function to publish chicken visit data
+bool NestTracker::publishChickenVisit(const OutboxRecord& record) {
+  const Chicken* chicken = chickenByHandle(record.chicken);
+
+  JsonDocument doc(&jsonArena);
+  PayloadFormat format = payloadFormats[VISITS];
+  if (format == MSGPACK) {
+    JsonArray fields = doc.to<JsonArray>();
+    fields.add(chicken->number);
+    fields.add(record.duration);
+    fields.add(record.timestampMs);
+  } else {
+    doc["chicken_name"] = chicken->name;
+    doc["chicken_number"] = chicken->number;
+    doc["duration"] = record.duration;
+    doc["timestamp"] = record.timestampMs; // When the visit ended, not when it was sent
+    doc["date"] = "2025-07-26"; // You might want to use NTP for real dates
+  }
+
+  size_t length = serializePayload(doc, hal.log, format);
+
+  return publishPayload(topicChickenVisits, length, format, &outboxReceipt);
+}
+
+// Function to publish chicken change events
+bool NestTracker::publishChickenChange(const OutboxRecord& record) {
+  JsonDocument doc(&jsonArena);
+  PayloadFormat format = payloadFormats[CHANGES];
+  if (format == MSGPACK) {
+    JsonArray fields = doc.to<JsonArray>();
+    fields.add(chickenByHandle(record.chicken)->number);
+    fields.add(chickenByHandle(record.other)->number);
+    fields.add(record.duration);
+    fields.add(record.timestampMs);
+  } else {
+    doc["event"] = "chicken_change";
+    doc["previous_chicken"] = chickenByHandle(record.chicken)->name;
+    doc["new_chicken"] = chickenByHandle(record.other)->name;
+    doc["previous_duration"] = record.duration;
+    doc["timestamp"] = record.timestampMs;
+    doc["date"] = "2025-07-26";
+  }
+
+  size_t length = serializePayload(doc, hal.log, format);
+
+  return publishPayload(topicChickenChanges, length, format, &outboxReceipt);
+}
+
+// Chickens removed from the registry since the event have nothing to report it as
+static bool outboxRecordKnown(const OutboxRecord& record) {
+  if (!chickenByHandle(record.chicken)) return false;
+  return record.kind != OUTBOX_CHANGE || chickenByHandle(record.other);
+}
+
+// Publish pending outbox records in rate-limited batches while connected. A record leaves
+// the outbox only once the publisher confirmed sending it; after a failed send everything
+// still in flight goes out again, so a visit may arrive twice but is never lost.
+void NestTracker::drainOutbox() {
+  settleOutbox();
+  if (!hal.publisher->connected() || outboxReceipt.blocked.load()) return;
+
+  unsigned long now = millis();
+  if (now - lastOutboxBatch >= OUTBOX_BATCH_INTERVAL_MS) {
+    lastOutboxBatch = now;
+    outboxBatchSent = 0;
+  }
+
+  while (outboxBatchSent < OUTBOX_BATCH_SIZE) {
+    const OutboxRecord* record = outbox.next();
+    if (!record) break;
+
+    if (!outboxRecordKnown(*record)) {
+      if (outbox.inFlightCount() > 0) break; // Dropped once everything before it is confirmed
+      outbox.pop();
+      continue;
+    }
+
+    bool sent = record->kind == OUTBOX_CHANGE ? publishChickenChange(*record) : publishChickenVisit(*record);
+    if (!sent) break; // Not taken (queue full): keep it for the next batch
+    outbox.markSent();
+    outboxBatchSent++;
+  }
+  settleOutbox(); // Direct publishers have reported already
+}
+
+// Apply the delivery reports: confirmed records leave the outbox, failed ones are sent again
+void NestTracker::settleOutbox() {
+  uint32_t delivered = outboxReceipt.delivered.load();
+  for (; outboxDelivered != delivered; outboxDelivered++) {
+    outbox.pop();
+  }
+
+  uint32_t failed = outboxReceipt.failed.load();
+  if (failed != outboxFailed) {
+    outbox.resend(failed - outboxFailed);
+    outboxFailed = failed;
+  }
+
+  // Nothing of ours left in the publisher: resume from the oldest unconfirmed record
+  if (outbox.inFlightCount() == 0 && outboxReceipt.blocked.load()) {
+    LOGW("! Outbox publish failed, resending %u records", (unsigned)outbox.size());
+    outboxReceipt.blocked.store(false);
+  }
+}
+
+// Append an outbox record to the visit history
+void NestTracker::logRecord(const OutboxRecord& outboxRecord) {
+  if (!visitLog.enabled()) return;
+
+  VisitLogRecord record = {};
+  record.time = visitLog.timeNow(millis(), hal.clock->epochSeconds(), record.flags);
+  record.duration = outboxRecord.duration;
+  record.chicken = outboxRecord.chicken;
+  record.other = outboxRecord.other;
+  record.kind = outboxRecord.kind;
+  if (!visitLog.append(record, millis())) {
+    LOGE("✗ Failed to write visit log");
+  }
+}
+
+bool NestTracker::requestVisitHistory(const char* request, size_t length) {
+  if (length >= sizeof(historyRequest) || historyRequested.load()) return false;
+  memcpy(historyRequest, request, length);
+  historyRequestLength = length;
+  historyRequested.store(true);
+  return true;
+}
+
+// One page of a visit history reply: [time, duration, number] per visit,
+// [time, previous duration, previous number, new number] per change
+struct HistoryPage {
+  JsonArray records;
+  uint32_t count;
+  uint32_t lastTime;   // Time of the last record added
+  uint32_t sameTime;   // Records at the end of the page sharing lastTime
+  uint32_t next;       // 0 = the query is complete
+};
+
+static bool addHistoryRecord(const VisitLogRecord& record, void* context) {
+  HistoryPage& page = *static_cast<HistoryPage*>(context);
+  if (page.count == VISIT_HISTORY_PAGE) {
+    // The next page starts at this record's second: take back the records of that second
+    // already on this one (several chickens can leave at once), unless that empties the page
+    page.next = record.time;
+    if (record.time == page.lastTime) {
+      if (page.sameTime < page.count) {
+        for (uint32_t i = 0; i < page.sameTime; i++) page.records.remove(page.count - 1 - i);
+      } else {
+        page.next = record.time + 1; // A whole page in one second: skip the rest of it
+      }
+    }
+    return false;
+  }
+
+  JsonArray fields = page.records.add<JsonArray>();
+  const Chicken* chicken = chickenByHandle(record.chicken);
+  fields.add(record.time);
+  fields.add(record.duration);
+  fields.add(chicken ? chicken->number : 0);
+  if (record.kind == OUTBOX_CHANGE) {
+    const Chicken* other = chickenByHandle(record.other);
+    fields.add(other ? other->number : 0);
+  }
+  page.sameTime = page.count > 0 && record.time == page.lastTime ? page.sameTime + 1 : 1;
+  page.lastTime = record.time;
+  page.count++;
+  return true;
+}
+
+// Answer a visit history request: one page of records, with "next" set to the "from" that
+// continues it. Times are Unix seconds (estimated until the wall clock was first set).
+void NestTracker::publishVisitHistory() {
+  if (!hal.publisher->connected()) return;
+
+  uint32_t from = 0;
+  uint32_t to = UINT32_MAX;
+  int number = 0;
+  {
+    JsonDocument request(&jsonArena);
+    bool valid = historyRequestLength == 0 || !deserializeJson(request, historyRequest, historyRequestLength);
+    from = request["from"] | from;
+    to = request["to"] | to;
+    number = request["chicken"] | number;
+    historyRequested.store(false);
+    if (!valid) {
+      LOGW("! Visit history request is not JSON, ignored");
+      return;
+    }
+  }
+
+  ChickenHandle chicken = NO_CHICKEN;
+  if (number != 0) {
+    chicken = (ChickenHandle)(number - 1); // Handles are numbers - 1
+    if (number < 0 || !chickenByHandle(chicken)) {
+      LOGW("! Visit history request for unknown chicken %d", number);
+      return;
+    }
+  }
+
+  JsonDocument doc(&jsonArena);
+  doc["from"] = from;
+  doc["to"] = to;
+  if (number != 0) doc["chicken"] = number;
+  HistoryPage page = { doc["records"].to<JsonArray>(), 0, 0, 0, 0 };
+  visitLog.query(from, to, chicken, addHistoryRecord, &page);
+  if (page.next) doc["next"] = page.next;
+
+  publishPayload(topicVisitHistory, serializePayload(doc, hal.log), JSON);
+}
+
+// Record a finished visit: stats update immediately, the MQTT message goes through the outbox
+void NestTracker::recordChickenVisit(ChickenHandle chicken, unsigned long duration) {
+  OutboxRecord record = {};
+  record.timestampMs = millis();
+  record.duration = duration;
+  record.chicken = chicken;
+  record.other = NO_CHICKEN;
+  record.kind = OUTBOX_VISIT;
+  outbox.push(record);
+  logRecord(record);
+
+  // Update chicken stats
+  updateChickenStats(chicken, duration);
+  presencePolicy.recordDwell(chicken, duration);
+
+  drainOutbox();
+}
+
+// Record a chicken change event
+void NestTracker::recordChickenChange(ChickenHandle previousChicken, ChickenHandle newChicken, unsigned long duration) {
+  OutboxRecord record = {};
+  record.timestampMs = millis();
+  record.duration = duration;
+  record.chicken = previousChicken;
+  record.other = newChicken;
+  record.kind = OUTBOX_CHANGE;
+  outbox.push(record);
+  logRecord(record);
+
+  drainOutbox();
+}
+
+// NEW: Function to publish simple comma-separated occupants format
+void NestTracker::publishSimpleOccupants() {
+  if (!hal.publisher->connected()) return;
+
+  char occupantsList[256];
+
+  if (!nestOccupied) {
+    // Empty nest
+    snprintf(occupantsList, sizeof(occupantsList), "Empty");
+  } else if (multiChickenMode && !occupancy.present().empty()) {
+    // Multiple chickens - create comma-separated list
+    buildChickenList(occupantsList, sizeof(occupantsList), ",");
+  } else {
+    // Single chicken
+    const Chicken* chicken = chickenByHandle(currentChicken);
+    snprintf(occupantsList, sizeof(occupantsList), "%s", chicken ? chicken->name : "Empty");
+  }
+
+  // Publish simple format to new topic
+  state.set(STATE_OCCUPANTS, occupantsList);
+}
+
+// Write chickenStats to storage once enough has changed
+void NestTracker::saveStatsIfDue() {
+  if (!statsStore.flushDue(millis())) return;
+  if (statsStore.flush(chickenStats, MAX_CHICKENS, millis())) {
+    LOGI("Stats saved (%u saves)", (unsigned)statsStore.saveCount());
+  } else if (hal.storage) {
+    LOGE("✗ Failed to save stats");
+  }
+}
+
+// Function to update chicken statistics
+void NestTracker::updateChickenStats(ChickenHandle chicken, unsigned long duration) {
+  if (chicken >= MAX_CHICKENS) return;
+
+  chickenStats[chicken].visits++;
+  chickenStats[chicken].totalTime += duration;
+  chickenStats[chicken].lastVisit = millis();
+
+  statsStore.markDirty(millis());
+  saveStatsIfDue();
+
+  // Only this chicken can move up; publish just the ranks that changed
+  leaderboard.update(chicken);
+  publishLeaderboardDelta();
+}
+
+static void addLeaderboardEntry(JsonArray entries, const Leaderboard& leaderboard, ChickenHandle chicken) {
+  const ChickenStats& stats = leaderboard.statsOf(chicken);
+  JsonObject entry = entries.add<JsonObject>();
+  entry["rank"] = leaderboard.rankOf(chicken) + 1;
+  entry["name"] = stats.name;
+  entry["visits"] = stats.visits;
+  entry["total_time"] = stats.totalTime;
+  entry["avg_time"] = stats.visits > 0 ? stats.totalTime / stats.visits : 0;
+}
+
+// Function to publish the full leaderboard (top 10)
+void NestTracker::publishLeaderboard() {
+  if (!hal.publisher->connected()) return;
+
+  JsonDocument doc(&jsonArena);
+  JsonArray entries = doc["leaderboard"].to<JsonArray>();
+  for (int rank = 0; rank < LEADERBOARD_SIZE; rank++) {
+    ChickenHandle chicken = leaderboard.at(rank);
+    if (chicken == NO_CHICKEN || !leaderboard.ranked(chicken)) break;
+    addLeaderboardEntry(entries, leaderboard, chicken);
+  }
+
+  doc["updated"] = millis();
+
+  serializePayload(doc, hal.log);
+
+  if (hal.publisher->publish(topicChickenLeaderboard, payload)) {
+    leaderboard.markPublished();
+    lastLeaderboardSnapshot = millis();
+    leaderboardSnapshotRequested = false;
+  }
+}
+
+// Publish only the ranks that changed since the last leaderboard message
+void NestTracker::publishLeaderboardDelta() {
+  const ChickenSet& changed = leaderboard.changed();
+  if (changed.empty() || !hal.publisher->connected()) return; // Changes accumulate while offline
+
+  JsonDocument doc(&jsonArena);
+  JsonArray entries = doc["changes"].to<JsonArray>();
+  JsonArray removed = doc["removed"].to<JsonArray>();
+  for (ChickenHandle chicken = changed.next(0); chicken != NO_CHICKEN; chicken = changed.next(chicken + 1)) {
+    if (leaderboard.ranked(chicken)) {
+      addLeaderboardEntry(entries, leaderboard, chicken);
+    } else if (leaderboard.wasPublished(chicken)) {
+      removed.add(leaderboard.statsOf(chicken).name); // Dropped out of the top 10
+    }
+  }
+  doc["updated"] = millis();
+
+  serializePayload(doc, hal.log);
+
+  if (hal.publisher->publish(topicChickenLeaderboardDelta, payload)) {
+    leaderboard.markPublished();
+  }
+}
+
+// Point the stats at the registry names; chickens no longer registered lose their stats
+void NestTracker::syncChickenStats() {
+  for (int i = 0; i < MAX_CHICKENS; i++) {
+    const Chicken* chicken = chickenByHandle((ChickenHandle)i);
+    chickenStats[i].name = chicken ? chicken->name : "";
+    if (!chicken) {
+      chickenStats[i].visits = 0;
+      chickenStats[i].totalTime = 0;
+      chickenStats[i].lastVisit = 0;
+    }
+  }
+}
+
+// The flock saved by the last registry update, else the built-in one
+void NestTracker::loadRegistry() {
+  size_t length = hal.storage ? hal.storage->load(REGISTRY_STORAGE_KEY, registryBuffer, sizeof(registryBuffer)) : 0;
+  if (length > 0 && chickenRegistry.deserialize(registryBuffer, length)) {
+    LOGI("✓ Chicken registry: %d chickens from storage", chickenRegistry.count());
+  } else {
+    loadDefaultChickens();
+    LOGI("Chicken registry: %d built-in chickens", chickenRegistry.count());
+  }
+  registrySource = chickenRegistry.source();
+}
+
+bool NestTracker::updateRegistry(const char* text, size_t length) {
+  if (length == 0 || length > REGISTRY_TEXT_MAX) return false;
+  if (crc32(text, length) == registrySource) return true; // Retained copy of what we already run
+  if (registryPending != 0) return false; // Previous update not applied yet
+
+  memcpy(registryBuffer, text, length);
+  registryPending = length;
+  return true;
+}
+
+bool NestTracker::allNestsEmpty() {
+  for (NestTracker* nest = nests; nest; nest = nest->nextNest) {
+    if (nest->nestOccupied) return false;
+  }
+  return true;
+}
+
+// Swap in a registry received by updateRegistry(). Waits until every nest is empty so
+// no chicken disappears mid-visit; handles are chicken numbers, so all other state stays valid.
+void NestTracker::applyPendingRegistry() {
+  size_t length = registryPending;
+  if (length == 0 || !allNestsEmpty()) return;
+
+  int badLine = chickenRegistry.parse((const char*)registryBuffer, length);
+  if (badLine != 0) {
+    LOGE("✗ Chicken registry rejected: line %d invalid, keeping the current one", badLine);
+    loadRegistry();
+  } else {
+    LOGI("✓ Chicken registry updated: %d chickens", chickenRegistry.count());
+    size_t size = chickenRegistry.serialize(registryBuffer, sizeof(registryBuffer));
+    if (hal.storage && (size == 0 || !hal.storage->save(REGISTRY_STORAGE_KEY, registryBuffer, size))) {
+      LOGE("✗ Failed to save chicken registry (active until reboot)");
+    }
+    registrySource = chickenRegistry.source();
+
+    // Stats are stored by tag: write them under the new tags right away
+    for (NestTracker* nest = nests; nest; nest = nest->nextNest) {
+      nest->syncChickenStats();
+      nest->leaderboard.rebuild(nest->chickenStats, MAX_CHICKENS);
+      nest->statsStore.markDirty(millis());
+      nest->statsStore.flush(nest->chickenStats, MAX_CHICKENS, millis());
+      nest->leaderboardSnapshotRequested = true; // Names or ranks may have changed
+    }
+  }
+  registryPending = 0;
+}
+
+void NestTracker::begin(const Hal& halImpl, const char* tag, OutboxSpill* outboxSpill,
+                        VisitLogFiles* visitLogFiles, const char* storageSuffix) {
+  hal = halImpl;
+  snprintf(nestTag, sizeof(nestTag), "%s", tag);
+  initTopics();
+  bool listed = false;
+  for (NestTracker* nest = nests; nest; nest = nest->nextNest) listed |= nest == this;
+  if (!listed) {
+    nextNest = nests;
+    nests = this;
+    nestCount++;
+  }
+
+  outbox.setSpill(outboxSpill);
+  if (visitLog.begin(visitLogFiles)) {
+    LOGI("Visit log: %u records", (unsigned)visitLog.size());
+  }
+
+  // One registry for all nests
+  if (!registryLoaded) {
+    loadRegistry();
+    registryLoaded = true;
+  }
+
+  // Initialize chicken stats
+  for (int i = 0; i < MAX_CHICKENS; i++) {
+    chickenStats[i].visits = 0;
+    chickenStats[i].totalTime = 0;
+    chickenStats[i].lastVisit = 0;
+  }
+  syncChickenStats();
+
+  // Continue from the stats saved before the last reboot
+  statsStore.begin(hal.storage, storageSuffix);
+  if (statsStore.restore(chickenStats, MAX_CHICKENS)) {
+    LOGI("✓ Restored chicken stats from storage");
+  }
+  leaderboard.rebuild(chickenStats, MAX_CHICKENS);
+
+  // Keep reader active
+  readerReset.begin(hal.resetPin);
+}
+
+// Function to start a reader reset to force a new read. Returns immediately;
+// updateReaderReset() advances the sequence on later loop passes.
+void NestTracker::resetReader() {
+  LOGD("→ Resetting RFID reader for fresh read...");
+
+  // Anything still buffered was read before the reset - clear it first
+  // (no UART here when a separate RFID task owns it)
+  if (hal.uart) {
+    while (hal.uart->available()) {
+      hal.uart->read();
+    }
+    rfidParser.reset();
+  }
+
+  // Clear validation state to force fresh detection
+  consecutiveValidReads = 0;
+  lastValidTag = 0;
+
+  readerReset.start(millis());
+  resetStartedAt = millis();
+  metrics.resets++;
+}
+
+// Advance the reset sequence and keep the presence-check window aligned with it
+void NestTracker::updateReaderReset() {
+  switch (readerReset.update(millis())) {
+    case ResetSequencer::RELEASED:
+      LOGD("→ RFID reset released, reader settling...");
+      break;
+    case ResetSequencer::SETTLED:
+      // The exit window starts once the reader is fully up, like the old blocking reset
+      lastResetTime = millis();
+      metrics.resetBusyMs += lastResetTime - resetStartedAt;
+      LOGD("✓ RFID reader reset complete - extended scanning window active...");
+      break;
+    default:
+      break;
+  }
+}
+
+// Non-blocking RFID reading: drain whatever the UART has into the frame parser
+// and return the first complete, checksum-valid tag (0 = nothing yet)
+TagId NestTracker::pollReader() {
+  while (hal.uart->available()) {
+    if (rfidParser.feed((uint8_t)hal.uart->read()) == El125Parser::FRAME) {
+      return rfidParser.tag();
+    }
+  }
+  return 0;
+}
+
+// Additional validation - must be consistent across reads
+bool NestTracker::validateRead(TagId tagID, unsigned long readTime) {
+  if (tagID == lastValidTag && (readTime - lastValidReadTime) < 2000) {
+    consecutiveValidReads++;
+  } else {
+    consecutiveValidReads = 1;
+    lastValidTag = tagID;
+  }
+
+  lastValidReadTime = readTime;
+
+  // Only accept tag if we have confident reads
+  return consecutiveValidReads >= 1; // Reduced from 2 to 1 for better responsiveness
+}
+
+// Function to check for multi-chicken indicators: a new chicken was read (and recorded)
+// while the previous one is still read often enough to count as present
+bool NestTracker::detectMultipleChickens(ChickenHandle chicken) {
+  // Only process valid chickens
+  if (chicken == NO_CHICKEN) {
+    return false;
+  }
+
+  return currentChicken != NO_CHICKEN && occupancy.present().count() >= 2 &&
+         occupancy.confidence(currentChicken, millis()) >= OCCUPANCY_PRESENT_CONFIDENCE;
+}
+
+// Function to reset multi-chicken detection once the nest is empty
+void NestTracker::resetMultiChickenDetection() {
+  multiChickenMode = false;
+  occupancy.clear();
+}
+
+void NestTracker::logChickenList() const {
+  if (TRACKER_LOG_LEVEL < LOG_LEVEL_DEBUG) return;
+
+  char info[48];
+  const ChickenSet& present = occupancy.present();
+  for (ChickenHandle h = present.next(0); h != NO_CHICKEN; h = present.next(h + 1)) {
+    LOGD("  %s (%u%%)", getChickenInfo(chickenByHandle(h), info, sizeof(info)),
+             (unsigned)occupancy.confidence(h, millis()));
+  }
+}
+
+void NestTracker::publishStatus() {
+  char info[48];
+
+  state.invalidate(); // Sent even if unchanged: heartbeat, and retained copies after a reconnect
+
+  if (!nestOccupied) {
+    LOGD("[%lumin] Empty", millis()/60000);
+    publishNestStatus("empty");
+  } else if (multiChickenMode) {
+    LOGD("[%lumin] Multiple chickens detected", millis()/60000);
+    publishNestStatus("multiple");
+  } else {
+    LOGD("[%lumin] Occupied by %s", millis()/60000, getChickenInfo(chickenByHandle(currentChicken), info, sizeof(info)));
+    const Chicken* chicken = chickenByHandle(currentChicken);
+    if (chicken) {
+      publishNestStatus("occupied", currentChicken);
+    }
+  }
+}
+
+static void addHistogram(JsonObject out, LatencyHistogram& histogram) {
+  out["n"] = histogram.count();
+  out["max"] = histogram.max();
+  JsonArray buckets = out["hist"].to<JsonArray>();
+  for (int i = 0; i < LATENCY_BUCKETS; i++) buckets.add(histogram.bucket(i));
+  histogram.reset(); // Each payload covers one interval
+}
+
+// Publish runtime metrics: where time goes, and where frames/messages get lost
+void NestTracker::publishMetrics() {
+  if (!hal.publisher->connected()) return;
+
+  PlatformDiagnostics platform = {};
+  if (hal.diagnostics) hal.diagnostics->collect(platform);
+  if (hal.uart) {
+    // The tracker owns the UART: its parser sees every frame
+    platform.framesReceived += rfidParser.framesAccepted();
+    platform.framesRejected += rfidParser.framesRejected();
+  }
+
+  JsonDocument doc(&jsonArena);
+  doc["uptime"] = millis() / 1000;
+  addHistogram(doc["update_us"].to<JsonObject>(), metrics.updateTime);
+  addHistogram(doc["frame_us"].to<JsonObject>(), metrics.handleTime);
+
+  JsonObject frames = doc["frames"].to<JsonObject>();
+  frames["rx"] = platform.framesReceived;
+  frames["rejected"] = platform.framesRejected;
+  frames["dropped"] = platform.framesDropped;
+  frames["handled"] = metrics.framesHandled;
+  frames["stale"] = metrics.staleFrames;
+  frames["unknown"] = metrics.unknownTags;
+  doc["uart_overflows"] = platform.uartOverflows;
+
+  JsonObject reset = doc["reset"].to<JsonObject>();
+  reset["count"] = metrics.resets;
+  reset["busy_ms"] = metrics.resetBusyMs;
+
+  JsonObject exits = doc["exit"].to<JsonObject>();
+  exits["count"] = metrics.exits;
+  exits["avg_s"] = metrics.exits ? metrics.exitLatencyTotalS / metrics.exits : 0;
+  exits["max_s"] = metrics.exitLatencyMaxS;
+  exits["policy"] = presencePolicy.mode() == PresencePolicy::FIXED ? "fixed" : "adaptive";
+
+  JsonObject heap = doc["heap"].to<JsonObject>();
+  heap["free"] = platform.freeHeap;
+  heap["min_free"] = platform.minFreeHeap;
+  heap["largest"] = platform.largestFreeBlock;
+
+  JsonObject publish = doc["publish"].to<JsonObject>();
+  publish["failed"] = platform.publishFailures;
+  publish["outbox"] = outbox.size();
+  publish["outbox_dropped"] = outbox.droppedCount();
+  publish["arena_peak"] = (uint32_t)jsonArena.highWater();
+  publish["state_sent"] = state.sentCount();
+  publish["state_skipped"] = state.skippedCount(); // Nest state staged again but unchanged
+
+  if (platform.connectionState) {
+    JsonObject connection = doc["connection"].to<JsonObject>();
+    connection["state"] = platform.connectionState;
+    connection["reconnects"] = platform.reconnects;
+    connection["failed_attempts"] = platform.connectFailures;
+  }
+
+  JsonObject registry = doc["registry"].to<JsonObject>();
+  registry["chickens"] = chickenRegistry.count();
+  registry["crc"] = chickenRegistry.source(); // Same value on every nest running the same registry
+
+  serializePayload(doc, hal.log);
+  hal.publisher->publish(topicSystemMetrics, payload);
+}
+
+// Current time between presence probes
+unsigned long NestTracker::presenceProbeInterval() const {
+  return presencePolicy.probeInterval(currentChicken, millis() - chickenEnterTime, multiChickenMode);
+}
+
+// Chickens that stopped being read left a shared nest on their own
+void NestTracker::updateOccupancy() {
+  char info[48];
+
+  ChickenSet departed = occupancy.update(millis(), currentChicken);
+  if (departed.empty()) return;
+
+  for (ChickenHandle h = departed.next(0); h != NO_CHICKEN; h = departed.next(h + 1)) {
+    unsigned long stayDuration = (occupancy.lastRead(h) - occupancy.since(h)) / 1000;
+    LOGI("*** %s LEFT THE SHARED NEST ***", getChickenInfo(chickenByHandle(h), info, sizeof(info)));
+    LOGI("Not read for %lus, stayed %lus", (millis() - occupancy.lastRead(h)) / 1000, stayDuration);
+    recordChickenVisit(h, stayDuration);
+  }
+  if (!multiChickenMode) return;
+
+  if (occupancy.present().count() >= 2) {
+    LOGD("Chickens still in nest:");
+    logChickenList();
+    LOGD("---");
+    publishNestStatus("multiple");
+  } else {
+    // Only the last chicken read is left: its visit started when it was first read
+    const Chicken* chicken = chickenByHandle(currentChicken);
+    multiChickenMode = false;
+    chickenEnterTime = occupancy.since(currentChicken);
+
+    LOGI("*** EXITING MULTI-CHICKEN MODE ***");
+    LOGI("Only %s left, in nest for %lus", getChickenInfo(chicken, info, sizeof(info)),
+             (millis() - chickenEnterTime) / 1000);
+    LOGD("Status: OCCUPIED BY SINGLE CHICKEN");
+    LOGD("===================");
+
+    publishNestStatus("occupied", currentChicken);
+  }
+}
+
+void NestTracker::updateTracking() {
+  char info[48];
+
+  // Deliver anything queued while offline (rate-limited)
+  drainOutbox();
+
+  // Heartbeat every 5 minutes (300 seconds)
+  if (millis() - lastHeartbeat > HEARTBEAT_INTERVAL_MS) {
+    publishStatus();
+
+    // Also publish system heartbeat and metrics
+    hal.publisher->publish(topicSystemStatus, "online");
+    publishMetrics();
+
+    lastHeartbeat = millis();
+  }
+
+  updateReaderReset();
+  applyPendingRegistry();
+
+  // Time-based stats save for quiet periods
+  saveStatsIfDue();
+
+  // Buffered visit history goes to flash while nothing is being tracked
+  if (!nestOccupied && visitLog.flushDue(millis()) && !visitLog.flush()) {
+    LOGE("✗ Failed to write visit log");
+  }
+
+  if (historyRequested.load()) publishVisitHistory();
+
+  // Full leaderboard on request and periodically, so late subscribers can resync
+  if (leaderboardSnapshotRequested || millis() - lastLeaderboardSnapshot >= LEADERBOARD_SNAPSHOT_INTERVAL_MS) {
+    publishLeaderboard();
+  }
+
+  if (nestOccupied) updateOccupancy();
+
+  // Smart presence check if nest is occupied (interval from the presence policy)
+  if (nestOccupied && !readerReset.busy() && (millis() - lastPresenceCheck > presenceProbeInterval())) {
+    LOGD("Checking if %s is still present...", getChickenInfo(chickenByHandle(currentChicken), info, sizeof(info)));
+    resetReader();
+    waitingForPresenceConfirmation = true;
+    lastPresenceCheck = millis();
+  }
+
+  // Check if chicken has left after reset (no detection within 8 seconds after reset)
+  if (waitingForPresenceConfirmation && !readerReset.busy() && (millis() - lastResetTime > EXIT_WINDOW_MS)) {
+    // No detection after reset = chicken has left
+    unsigned long sessionDuration = (millis() - chickenEnterTime) / 1000;
+
+    // The chicken left somewhere after its last read: that is the worst case latency
+    uint32_t exitLatency = (millis() - lastSeenTime) / 1000;
+    metrics.exits++;
+    metrics.exitLatencyTotalS += exitLatency;
+    if (exitLatency > metrics.exitLatencyMaxS) metrics.exitLatencyMaxS = exitLatency;
+
+    if (multiChickenMode) {
+      LOGI("*** MULTIPLE CHICKENS LEFT NEST! ***");
+      LOGI("Last detected: %s", getChickenInfo(chickenByHandle(currentChicken), info, sizeof(info)));
+      LOGI("Multi-chicken session duration: %lu seconds", sessionDuration);
+
+      // Everyone still counted as present left with the group
+      const ChickenSet& present = occupancy.present();
+      for (ChickenHandle h = present.next(0); h != NO_CHICKEN; h = present.next(h + 1)) {
+        recordChickenVisit(h, (millis() - occupancy.since(h)) / 1000);
+      }
+
+      // Publish multi-chicken session end
+      publishNestStatus("empty");
+
+    } else {
+      LOGI("*** CHICKEN LEFT NEST! ***");
+      LOGI("Chicken: %s", getChickenInfo(chickenByHandle(currentChicken), info, sizeof(info)));
+      LOGI("Session Duration: %lu seconds", sessionDuration);
+
+      // Publish single chicken visit
+      const Chicken* chicken = chickenByHandle(currentChicken);
+      if (chicken) {
+        recordChickenVisit(currentChicken, sessionDuration);
+        publishNestStatus("empty");
+      }
+    }
+    LOGD("Status: EMPTY");
+    LOGD("===================");
+
+    // Reset state
+    nestOccupied = false;
+    currentChicken = NO_CHICKEN;
+    chickenEnterTime = 0;
+    waitingForPresenceConfirmation = false;
+    resetMultiChickenDetection();
+  }
+
+}
+
+void NestTracker::processTag(TagId tagID, unsigned long readTime) {
+  char info[48];
+
+  // While RES is held low nothing on the line belongs to a fresh read.
+  // Frames that arrive while settling come from the restarted reader and count as fresh reads.
+  // Until a presence probe is answered, frames read before its reset don't count either.
+  if (!readerReset.acceptsReadAt(readTime, waitingForPresenceConfirmation)) {
+    metrics.staleFrames++;
+    return;
+  }
+
+  if (!validateRead(tagID, readTime)) {
+    return;
+  }
+
+  // Resolve the tag to a handle once; everything below works on the handle
+  ChickenHandle handle = findChickenHandle(tagID);
+  const Chicken* chicken = chickenByHandle(handle);
+  char tagText[TAG_TEXT_LEN];
+  formatTagID(tagID, tagText, sizeof(tagText));
+  char chickenInfo[48];
+  getChickenInfo(chicken, chickenInfo, sizeof(chickenInfo));
+  unsigned long currentTime = readTime;
+
+  // Check if this is a valid chicken
+  if (chicken == nullptr) {
+    LOGW("! Unknown tag: %s (ignored)", tagText);
+    metrics.unknownTags++;
+    return; // Ignore unknown chickens
+  }
+  lastSeenTime = currentTime;
+  occupancy.recordRead(handle, currentTime);
+
+  if (!nestOccupied) {
+    // Chicken entering nest
+    nestOccupied = true;
+    currentChicken = handle;
+    chickenEnterTime = currentTime;
+    lastPresenceCheck = currentTime;
+    waitingForPresenceConfirmation = false; // Not waiting when chicken enters
+
+    LOGI("*** CHICKEN ENTERED NEST! ***");
+    LOGI("Chicken: %s | Tag: %s", chickenInfo, tagText);
+    LOGD("Time: %lus", currentTime/1000);
+    LOGD("Status: OCCUPIED");
+    LOGD("===================");
+
+    // Publish chicken entry
+    publishNestStatus("occupied", handle);
+
+  } else if (currentChicken == handle) {
+    // Same chicken still present - just update check time
+    lastPresenceCheck = currentTime;
+    waitingForPresenceConfirmation = false; // Cancel the waiting state
+
+    // In multi-chicken mode the other chickens drop out as their reads stop (updateOccupancy)
+    if (multiChickenMode) {
+      LOGD("✓ %s detected (%d chickens in nest)", chickenInfo, occupancy.present().count());
+    } else {
+      LOGD("✓ %s confirmed present", chickenInfo);
+    }
+
+  } else {
+    // Different chicken detected while nest occupied
+    unsigned long sessionDuration = (currentTime - chickenEnterTime) / 1000;
+
+    // Check if this indicates multiple chickens
+    if (detectMultipleChickens(handle)) {
+      if (!multiChickenMode) {
+        // First time detecting multiple chickens
+        multiChickenMode = true;
+
+        LOGI("*** MULTIPLE CHICKENS DETECTED! ***");
+        LOGI("%s read while the previous chicken is still present - cuddling chickens!", chickenInfo);
+        LOGD("Chickens seen: ");
+        logChickenList();
+        LOGD("Status: MULTIPLE CHICKENS IN NEST");
+        LOGD("===================");
+
+        // Publish multi-chicken detection to MQTT
+        publishNestStatus("multiple");
+
+      } else {
+        // Already in multi-chicken mode, but show updated list
+        LOGD("~ Multi-chicken activity continues ~");
+        LOGD("Updated chicken list:");
+        logChickenList();
+        LOGD("---");
+
+        // Update MQTT with continued multi-chicken activity
+        publishNestStatus("multiple");
+      }
+    } else {
+      // Normal chicken change - publish the previous chicken's visit first
+      LOGI(">>> CHICKEN CHANGE! <<<");
+      LOGI("Previous: %s (was there %lus)", getChickenInfo(chickenByHandle(currentChicken), info, sizeof(info)), sessionDuration);
+      LOGI("New: %s | Tag: %s", chickenInfo, tagText);
+      LOGD("Status: OCCUPIED BY NEW CHICKEN");
+      LOGD("===================");
+
+      // Publish detailed chicken change event to MQTT
+      const Chicken* prevChicken = chickenByHandle(currentChicken);
+      const Chicken* newChicken = chicken;
+
+      if (prevChicken && newChicken) {
+        // Publish the previous chicken's visit
+        recordChickenVisit(currentChicken, sessionDuration);
+        occupancy.remove(currentChicken);
+
+        // Publish the chicken change event
+        recordChickenChange(currentChicken, handle, sessionDuration);
+
+        // Update nest status with new chicken (status, occupant and occupants go out once, at the end of this pass)
+        publishNestStatus("occupied", handle);
+
+        LOGD("MQTT: Updated occupant to %s", newChicken->name);
+      }
+    }
+
+    // Update to new chicken
+    currentChicken = handle;
+    chickenEnterTime = currentTime;
+    lastPresenceCheck = currentTime;
+    waitingForPresenceConfirmation = false; // Cancel waiting state
+  }
+}
+
+void NestTracker::setPayloadFormat(PayloadTopic topic, PayloadFormat format) {
+  if (topic >= 0 && topic < PAYLOAD_TOPICS) payloadFormats[topic] = format;
+}
+
+void NestTracker::setPresencePolicy(PresencePolicy::Mode mode) {
+  presencePolicy.setMode(mode);
+}
+
+void NestTracker::update() {
+  unsigned long start = hal.clock->micros();
+  updateTracking();
+  flushState();
+  metrics.updateTime.record((uint32_t)(hal.clock->micros() - start));
+}
+
+// Time left until 'intervalMs' has passed since 'since', for the "> interval" checks above
+static unsigned long msUntilAfter(unsigned long since, unsigned long intervalMs, unsigned long now) {
+  unsigned long elapsed = now - since;
+  return elapsed > intervalMs ? 0 : intervalMs - elapsed + 1;
+}
+
+unsigned long NestTracker::idleMs() {
+  unsigned long now = millis();
+  unsigned long idle = TRACKING_MAX_IDLE_MS;
+  auto keepEarliest = [&idle](unsigned long ms) {
+    if (ms < idle) idle = ms;
+  };
+
+  keepEarliest(msUntilAfter(lastHeartbeat, HEARTBEAT_INTERVAL_MS, now));
+  keepEarliest(readerReset.msUntilUpdate(now));
+  keepEarliest(statsStore.msUntilFlush(now));
+  if (!nestOccupied) keepEarliest(visitLog.msUntilFlush(now));
+  if (nestOccupied) keepEarliest(occupancy.msUntilChange(now, currentChicken));
+  if (registryPending != 0 && allNestsEmpty()) keepEarliest(0);
+
+  if (!readerReset.busy()) {
+    if (nestOccupied) keepEarliest(msUntilAfter(lastPresenceCheck, presenceProbeInterval(), now));
+    if (waitingForPresenceConfirmation) keepEarliest(msUntilAfter(lastResetTime, EXIT_WINDOW_MS, now));
+  }
+
+  // Publishing work only counts while there is a connection to publish on
+  if (hal.publisher->connected()) {
+    // Records in flight wait for the publisher's report, which comes with a wake-up
+    if (outbox.next() && !outboxReceipt.blocked.load()) {
+      keepEarliest(msUntilAfter(lastOutboxBatch, OUTBOX_BATCH_INTERVAL_MS - 1, now));
+    }
+    if (leaderboardSnapshotRequested || historyRequested.load()) keepEarliest(0);
+    if (state.pending()) keepEarliest(0); // Frames handed over by handleTag() changed the nest state
+    keepEarliest(msUntilAfter(lastLeaderboardSnapshot, LEADERBOARD_SNAPSHOT_INTERVAL_MS - 1, now));
+  }
+  return idle;
+}
+
+void NestTracker::handleTag(TagId tagID, unsigned long readTime) {
+  unsigned long start = hal.clock->micros();
+  metrics.framesHandled++;
+  processTag(tagID, readTime);
+  metrics.handleTime.record((uint32_t)(hal.clock->micros() - start));
+}
+
+void NestTracker::tick() {
+  update();
+
+  // Check for RFID data
+  TagId tagID = pollReader();
+  if (tagID != 0) {
+    handleTag(tagID, millis());
+    flushState();
+  }
+}
@@ -0,0 +1,235 @@
+#ifndef NEST_TRACKER_H
+#define NEST_TRACKER_H
+
+#include "Hal.h"
+#include "El125Parser.h"
+#include "ChickenDatabase.h"
+#include "ChickenStats.h"
+#include "ResetSequencer.h"
+#include "StatsStore.h"
+#include "Leaderboard.h"
+#include "OccupancyEstimator.h"
+#include "Outbox.h"
+#include "VisitLog.h"
+#include "Metrics.h"
+#include "PresencePolicy.h"
+#include "StatePublisher.h"
+#include <atomic>
+
+// Portable nest tracking logic (enter/exit, multi-chicken detection, scoring, MQTT payloads).
+// One NestTracker per EL125 reader; several can share a board, a publisher and a storage.
+// Everything hardware specific goes through the Hal passed to begin().
+
+#define LEADERBOARD_SNAPSHOT_INTERVAL_MS 3600000UL // Full leaderboard hourly, deltas in between
+#define HEARTBEAT_INTERVAL_MS 300000UL    // Status + system heartbeat every 5 minutes
+#define EXIT_WINDOW_MS 8000UL             // No read this long after a reset = chicken left
+#define TRACKING_MAX_IDLE_MS 60000UL      // Upper bound for idleMs()
+#define NEST_TAG_MAX 8                    // Nest tag incl. terminator ("A", "B", "12", ...)
+#define NEST_TOPIC_MAX 64
+#define VISIT_HISTORY_REQUEST_MAX 96      // Longest visit history request payload
+#define VISIT_HISTORY_PAGE 32             // Records per visit history reply
+
+// Retained chicken registry shared by all nests (ChickenRegistry text form), subscribed by
+// the connection code. The last one applied is kept in storage under REGISTRY_STORAGE_KEY.
+#define REGISTRY_TOPIC "chickens/config/registry"
+#define REGISTRY_STORAGE_KEY "registry"
+
+// Compact payloads (MessagePack), selected per topic with NestTracker::setPayloadFormat():
+// arrays instead of objects, chicken numbers instead of names, no date.
+//   visits:  [number, duration s, timestamp ms]
+//   changes: [previous number, new number, previous duration s, timestamp ms]
+//   status:  [status, timestamp ms, duration s, [numbers], [confidence %]]
+
+// A decoded frame with the time it was read, as passed from an RFID acquisition task
+struct TagEvent {
+  TagId tag;
+  unsigned long timeMs;
+};
+
+class NestTracker {
+public:
+  // Compose topics for this nest and reset all tracking state. The first nest to begin loads
+  // the chicken registry. hal.uart may be nullptr when frames are delivered through handleTag().
+  // outboxSpill optionally extends the RAM outbox for visits/changes produced while offline.
+  // visitLogFiles optionally keeps every visit/change in the on-device history.
+  // Nests sharing hal.storage need different storageSuffix values ("" for the first one).
+  void begin(const Hal& hal, const char* nestTag, OutboxSpill* outboxSpill = nullptr,
+             VisitLogFiles* visitLogFiles = nullptr, const char* storageSuffix = "");
+
+  // Timer side of the tracking logic: heartbeat, reader reset sequence, presence check, exit detection
+  void update();
+
+  // Milliseconds until update() has work due (0 = now): heartbeat, reset phases,
+  // presence check, exit window, stats flush, outbox batches and leaderboard snapshots.
+  // A new frame or a (re)connect can make work due earlier; callers should wake on those too.
+  unsigned long idleMs();
+
+  // Feed one decoded frame, read at readTime (HalClock milliseconds)
+  void handleTag(TagId tagID, unsigned long readTime);
+
+  // One pass of the tracking logic: update() plus polling hal.uart for a frame.
+  // Used when the tracker owns the UART (single loop, native and replay builds). Never sleeps.
+  void tick();
+
+  // Publish the current nest state (heartbeat, and after a reconnect), even if unchanged
+  void publishStatus();
+
+  // Stage the status, occupant(s) and duration topics. Sent at the end of the current
+  // update()/tick(), and only the ones that differ from what was last sent. The occupant is the
+  // chicken of an "occupied" status; a "multiple" one lists everyone present.
+  void publishNestStatus(const char* status, ChickenHandle occupant = NO_CHICKEN, int duration = 0);
+
+  // Publish runtime metrics on chickens/nest<tag>/system/metrics (also sent with every heartbeat)
+  void publishMetrics();
+
+  // Publish the full leaderboard on the next update(). Safe to call from another task.
+  void requestLeaderboard() { leaderboardSnapshotRequested = true; }
+
+  // Counters and histograms behind the metrics payload (exit latency, resets, frames...)
+  const TrackingMetrics& trackingMetrics() const { return metrics; }
+
+  const char* tag() const { return nestTag; }
+
+  // Per-nest system heartbeat topic (published by the connection code on connect)
+  const char* systemStatusTopic() const { return topicSystemStatus; }
+
+  // Any message here asks for a full leaderboard (subscribed by the connection code)
+  const char* leaderboardRequestTopic() const { return topicLeaderboardRequest; }
+
+  // On-device visit/change history (empty unless begin() got visit log files)
+  VisitLog& visits() { return visitLog; }
+
+  // Queue a visit history query, answered on chickens/nest<tag>/visits/history by the next
+  // update() once connected. Payload: {"from":s,"to":s,"chicken":number}, every field optional.
+  // Safe to call from another task. false = too long, or the previous request is still pending.
+  bool requestVisitHistory(const char* request, size_t length);
+
+  // Visit history requests arrive here (subscribed by the connection code)
+  const char* visitHistoryRequestTopic() const { return topicVisitHistoryRequest; }
+
+  // Choose how often occupied nests are probed (default ADAPTIVE). Visit lengths are
+  // learned per chicken, across all nests.
+  static void setPresencePolicy(PresencePolicy::Mode mode);
+
+  // Wire format per high-rate topic (default JSON everywhere). Home Assistant reads the
+  // JSON status, so keep STATUS as JSON unless nothing but the aggregator consumes it.
+  enum PayloadTopic { VISITS, CHANGES, STATUS, PAYLOAD_TOPICS };
+  enum PayloadFormat { JSON, MSGPACK };
+  static void setPayloadFormat(PayloadTopic topic, PayloadFormat format);
+
+  // Queue a new chicken registry (text form) to be applied once every nest is empty.
+  // Safe to call from another task. false = too long, or the previous update is still pending.
+  static bool updateRegistry(const char* text, size_t length);
+
+private:
+  void log(const char* format, ...) const __attribute__((format(printf, 2, 3)));
+  unsigned long millis() const { return hal.clock->millis(); }
+  void initTopics();
+
+  void updateTracking();
+  void processTag(TagId tagID, unsigned long readTime);
+  TagId pollReader();
+  bool validateRead(TagId tagID, unsigned long readTime);
+  bool detectMultipleChickens(ChickenHandle chicken);
+  void resetMultiChickenDetection();
+  void resetReader();
+  void updateReaderReset();
+  void updateOccupancy();
+  unsigned long presenceProbeInterval() const;
+
+  bool publishPayload(const char* topic, size_t length, PayloadFormat format, DeliveryReceipt* receipt = nullptr);
+  void flushState();
+  void buildChickenList(char* out, size_t outSize, const char* separator) const;
+  void logChickenList() const;
+  void publishSimpleOccupants();
+  bool publishChickenVisit(const OutboxRecord& record);
+  bool publishChickenChange(const OutboxRecord& record);
+  void drainOutbox();
+  void settleOutbox();
+  void logRecord(const OutboxRecord& record);
+  void recordChickenVisit(ChickenHandle chicken, unsigned long duration);
+  void recordChickenChange(ChickenHandle previousChicken, ChickenHandle newChicken, unsigned long duration);
+
+  void updateChickenStats(ChickenHandle chicken, unsigned long duration);
+  void saveStatsIfDue();
+  void syncChickenStats();
+  void publishLeaderboard();
+  void publishLeaderboardDelta();
+  void publishVisitHistory();
+
+  void loadRegistry();
+  static bool allNestsEmpty();
+  void applyPendingRegistry();
+
+  Hal hal = {};
+  char nestTag[NEST_TAG_MAX] = "";
+  NestTracker* nextNest = nullptr; // All nests that began, for registry updates
+
+  // MQTT Topics (per nest tag). Example when the tag is "A": chickens/nestA/status
+  char topicNestStatus[NEST_TOPIC_MAX];
+  char topicNestOccupant[NEST_TOPIC_MAX];
+  char topicNestOccupants[NEST_TOPIC_MAX];  // Simple comma-separated format
+  char topicNestDuration[NEST_TOPIC_MAX];
+  char topicChickenVisits[NEST_TOPIC_MAX];
+  char topicChickenLeaderboard[NEST_TOPIC_MAX];
+  char topicChickenLeaderboardDelta[NEST_TOPIC_MAX];
+  char topicLeaderboardRequest[NEST_TOPIC_MAX];
+  char topicChickenChanges[NEST_TOPIC_MAX];
+  char topicVisitHistory[NEST_TOPIC_MAX];
+  char topicVisitHistoryRequest[NEST_TOPIC_MAX];
+  char topicSystemStatus[NEST_TOPIC_MAX];
+  char topicSystemMetrics[NEST_TOPIC_MAX];
+
+  // Nest state topics, coalesced per tracker pass
+  enum StateTopic { STATE_STATUS, STATE_OCCUPANT, STATE_OCCUPANTS, STATE_DURATION };
+  StatePublisher state;
+
+  // Scoring
+  ChickenStats chickenStats[MAX_CHICKENS]; // Indexed by chicken handle
+  StatsStore statsStore;         // Persists chickenStats across reboots (batched writes)
+  Leaderboard leaderboard;       // chickenStats ranked by visits, updated per visit
+  unsigned long lastLeaderboardSnapshot = 0;
+  std::atomic<bool> leaderboardSnapshotRequested{true}; // Full leaderboard once connected after boot
+
+  El125Parser rfidParser;
+  ResetSequencer readerReset;
+  unsigned long resetStartedAt = 0;
+  unsigned long lastHeartbeat = 0;
+
+  // Runtime instrumentation, published with the heartbeat
+  TrackingMetrics metrics = {};
+
+  // Visits and changes wait here until they are published (survives broker/WiFi outages)
+  Outbox outbox;
+  unsigned long lastOutboxBatch = 0;
+  int outboxBatchSent = 0;
+  DeliveryReceipt outboxReceipt;   // Reported by the publisher, possibly from another task
+  uint32_t outboxDelivered = 0;    // Reports already applied
+  uint32_t outboxFailed = 0;
+
+  // Every visit/change also goes to the on-device history
+  VisitLog visitLog;
+  char historyRequest[VISIT_HISTORY_REQUEST_MAX]; // Written by requestVisitHistory() while not pending
+  size_t historyRequestLength = 0;
+  std::atomic<bool> historyRequested{false};
+
+  // Data validation
+  int consecutiveValidReads = 0;
+  TagId lastValidTag = 0;
+  unsigned long lastValidReadTime = 0;
+
+  // Smart tracking
+  ChickenHandle currentChicken = NO_CHICKEN;
+  unsigned long chickenEnterTime = 0;
+  unsigned long lastPresenceCheck = 0;
+  unsigned long lastSeenTime = 0;  // Last read of the current chicken (for exit latency)
+  unsigned long lastResetTime = 0; // When the last reset finished settling
+  bool nestOccupied = false;
+  bool waitingForPresenceConfirmation = false;
+
+  // Multi-chicken detection
+  bool multiChickenMode = false;
+  OccupancyEstimator occupancy; // Per-chicken read rates: who is still in the nest
+};
+
+#endif
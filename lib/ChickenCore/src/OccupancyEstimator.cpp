@@ -0,0 +1,139 @@
+#include "OccupancyEstimator.h"
+
+void OccupancyEstimator::clear() {
+  for (int s = 0; s < OCCUPANCY_SLOTS; s++) {
+    stays[s].chicken = NO_CHICKEN;
+    stays[s].head = 0;
+    stays[s].count = 0;
+    stays[s].start = 0;
+  }
+  live.clear();
+}
+
+int OccupancyEstimator::slotOf(ChickenHandle chicken) const {
+  for (int s = 0; s < OCCUPANCY_SLOTS; s++) {
+    if (stays[s].chicken == chicken) return s;
+  }
+  return -1;
+}
+
+// Slot for a chicken starting a new stay: its previous one, else a slot nobody live uses
+// (the least recently read), else the live chicken that has been silent longest
+OccupancyEstimator::Stay& OccupancyEstimator::claim(ChickenHandle chicken) {
+  Stay* best = nullptr;
+  for (int s = 0; s < OCCUPANCY_SLOTS; s++) {
+    Stay& stay = stays[s];
+    if (stay.chicken == chicken) return stay;
+    if (stay.chicken == NO_CHICKEN) {
+      if (!best || best->chicken != NO_CHICKEN) best = &stay;
+      continue;
+    }
+    if (best && best->chicken == NO_CHICKEN) continue;
+
+    bool busy = live.contains(stay.chicken);
+    bool bestBusy = best && live.contains(best->chicken);
+    if (!best || (bestBusy && !busy) || (bestBusy == busy && stay.last() < best->last())) best = &stay;
+  }
+  if (best->chicken != NO_CHICKEN) live.remove(best->chicken);
+  return *best;
+}
+
+void OccupancyEstimator::recordRead(ChickenHandle chicken, unsigned long now) {
+  if (chicken >= MAX_CHICKENS) return;
+
+  Stay* stay;
+  if (!live.contains(chicken)) {
+    // New stay: reads from an earlier stay say nothing about this one
+    stay = &claim(chicken);
+    stay->chicken = chicken;
+    stay->count = 0;
+    stay->head = 0;
+    stay->start = now;
+    live.add(chicken);
+  } else {
+    stay = &stays[slotOf(chicken)];
+    if (now - stay->last() < OCCUPANCY_MERGE_MS) {
+      stay->reads[(stay->head + OCCUPANCY_RING_SIZE - 1) % OCCUPANCY_RING_SIZE] = now; // Same read (repeated frames)
+      return;
+    }
+  }
+
+  stay->reads[stay->head] = now;
+  stay->head = (stay->head + 1) % OCCUPANCY_RING_SIZE;
+  if (stay->count < OCCUPANCY_RING_SIZE) stay->count++;
+}
+
+unsigned long OccupancyEstimator::since(ChickenHandle chicken) const {
+  int slot = slotOf(chicken);
+  return slot >= 0 ? stays[slot].start : 0;
+}
+
+unsigned long OccupancyEstimator::lastRead(ChickenHandle chicken) const {
+  int slot = slotOf(chicken);
+  return slot >= 0 ? stays[slot].last() : 0;
+}
+
+// Average gap between the reads still inside the window. Never shorter than the reader
+// can manage with every chicken in the nest taking turns.
+unsigned long OccupancyEstimator::expectedGap(const Stay& stay, unsigned long now) const {
+  unsigned long last = stay.last();
+  unsigned long first = last;
+  int gaps = 0;
+  for (int i = 1; i < stay.count; i++) {
+    unsigned long read = stay.reads[(stay.head + OCCUPANCY_RING_SIZE - 1 - i) % OCCUPANCY_RING_SIZE];
+    if (now - read > OCCUPANCY_WINDOW_MS) break;
+    first = read;
+    gaps++;
+  }
+
+  unsigned long gap = gaps > 0 ? (last - first) / gaps : OCCUPANCY_DEFAULT_GAP_MS;
+  if (gap > OCCUPANCY_MAX_GAP_MS) gap = OCCUPANCY_MAX_GAP_MS;
+  unsigned long minGap = OCCUPANCY_MIN_GAP_MS * live.count();
+  if (gap < minGap) gap = minGap;
+  return gap;
+}
+
+uint8_t OccupancyEstimator::confidence(const Stay& stay, unsigned long now) const {
+  unsigned long gap = expectedGap(stay, now);
+  unsigned long silence = now - stay.last();
+  if (silence <= gap) return 100;
+  if (silence >= gap * OCCUPANCY_MISSED_GAPS) return 0;
+  return (uint8_t)(100 * (gap * OCCUPANCY_MISSED_GAPS - silence) / (gap * (OCCUPANCY_MISSED_GAPS - 1)));
+}
+
+uint8_t OccupancyEstimator::confidence(ChickenHandle chicken, unsigned long now) const {
+  if (chicken >= MAX_CHICKENS || !live.contains(chicken)) return 0;
+  return confidence(stays[slotOf(chicken)], now);
+}
+
+// Silence after which confidence() drops below OCCUPANCY_PRESENT_CONFIDENCE
+unsigned long OccupancyEstimator::dropSilence(const Stay& stay, unsigned long now) const {
+  unsigned long gap = expectedGap(stay, now);
+  return gap * OCCUPANCY_MISSED_GAPS - gap * (OCCUPANCY_MISSED_GAPS - 1) * OCCUPANCY_PRESENT_CONFIDENCE / 100;
+}
+
+ChickenSet OccupancyEstimator::update(unsigned long now, ChickenHandle keep) {
+  ChickenSet departed;
+  for (int s = 0; s < OCCUPANCY_SLOTS; s++) {
+    const Stay& stay = stays[s];
+    if (stay.chicken == NO_CHICKEN || stay.chicken == keep || !live.contains(stay.chicken)) continue;
+    if (confidence(stay, now) < OCCUPANCY_PRESENT_CONFIDENCE) departed.add(stay.chicken);
+  }
+  for (ChickenHandle h = departed.next(0); h != NO_CHICKEN; h = departed.next(h + 1)) {
+    live.remove(h);
+  }
+  return departed;
+}
+
+unsigned long OccupancyEstimator::msUntilChange(unsigned long now, ChickenHandle keep) const {
+  unsigned long earliest = (unsigned long)-1;
+  for (int s = 0; s < OCCUPANCY_SLOTS; s++) {
+    const Stay& stay = stays[s];
+    if (stay.chicken == NO_CHICKEN || stay.chicken == keep || !live.contains(stay.chicken)) continue;
+    unsigned long silence = now - stay.last();
+    unsigned long drop = dropSilence(stay, now);
+    unsigned long ms = silence > drop ? 0 : drop - silence + 1;
+    if (ms < earliest) earliest = ms;
+  }
+  return earliest;
+}
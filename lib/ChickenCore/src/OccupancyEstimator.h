@@ -0,0 +1,79 @@
+#ifndef OCCUPANCY_ESTIMATOR_H
+#define OCCUPANCY_ESTIMATOR_H
+
+#include "ChickenDatabase.h"
+#include "ChickenSet.h"
+
+// Which chickens are in the nest right now, from how often each tag is being read.
+// The EL125 reports one tag at a time, so with several chickens in the nest each one is
+// read only every so often. Every chicken keeps its last reads in a small ring; the
+// average gap between them is that chicken's expected read interval. Confidence stays at
+// 100% for one expected gap of silence and falls to 0% after OCCUPANCY_MISSED_GAPS gaps,
+// so each chicken drops out of the live set on its own schedule instead of the whole
+// group staying "multiple" until everyone has left.
+// Only a handful of chickens fit in one nest box, so the rings live in OCCUPANCY_SLOTS
+// slots per nest instead of one per possible chicken.
+
+#define OCCUPANCY_SLOTS 6                    // Chickens tracked at once (the longest silent one is replaced)
+#define OCCUPANCY_RING_SIZE 8                // Reads kept per chicken
+#define OCCUPANCY_WINDOW_MS 120000UL         // Reads older than this no longer count for the read rate
+#define OCCUPANCY_MERGE_MS 500UL             // Repeated frames closer than this are one read
+#define OCCUPANCY_MIN_GAP_MS 3000UL          // Per chicken sharing the reader: it reports one tag at a time
+#define OCCUPANCY_DEFAULT_GAP_MS 30000UL     // Expected gap until a chicken has two reads in the window
+#define OCCUPANCY_MAX_GAP_MS 120000UL
+#define OCCUPANCY_MISSED_GAPS 5              // Confidence reaches 0 after this many expected gaps
+#define OCCUPANCY_PRESENT_CONFIDENCE 50      // Below this (percent) a chicken has left
+
+class OccupancyEstimator {
+public:
+  OccupancyEstimator() { clear(); }
+
+  // Nest empty: forget everything
+  void clear();
+
+  // A frame of this chicken was read at 'now'. A chicken that was not live starts a new stay.
+  void recordRead(ChickenHandle chicken, unsigned long now);
+
+  // 0-100 for a chicken of the live set
+  uint8_t confidence(ChickenHandle chicken, unsigned long now) const;
+
+  // The chicken's visit was closed some other way (replaced by another chicken)
+  void remove(ChickenHandle chicken) { live.remove(chicken); }
+
+  // Drop chickens whose confidence fell below OCCUPANCY_PRESENT_CONFIDENCE and return them.
+  // 'keep' is never dropped (the last chicken read, covered by the nest exit check).
+  ChickenSet update(unsigned long now, ChickenHandle keep);
+
+  // Milliseconds until update() would drop a chicken other than 'keep' (0 = now)
+  unsigned long msUntilChange(unsigned long now, ChickenHandle keep) const;
+
+  const ChickenSet& present() const { return live; }
+
+  // Current (or last) stay of a chicken: first read and last read (0 once its slot was reused)
+  unsigned long since(ChickenHandle chicken) const;
+  unsigned long lastRead(ChickenHandle chicken) const;
+
+private:
+  // One chicken's stay. A slot stays readable after its chicken left the live set
+  // until another chicken needs it.
+  struct Stay {
+    ChickenHandle chicken; // NO_CHICKEN = never used
+    uint8_t head;          // Next ring position
+    uint8_t count;
+    unsigned long start;
+    unsigned long reads[OCCUPANCY_RING_SIZE];
+
+    unsigned long last() const { return reads[(head + OCCUPANCY_RING_SIZE - 1) % OCCUPANCY_RING_SIZE]; }
+  };
+
+  int slotOf(ChickenHandle chicken) const; // -1 = no slot
+  Stay& claim(ChickenHandle chicken);
+  unsigned long expectedGap(const Stay& stay, unsigned long now) const;
+  unsigned long dropSilence(const Stay& stay, unsigned long now) const;
+  uint8_t confidence(const Stay& stay, unsigned long now) const;
+
+  Stay stays[OCCUPANCY_SLOTS];
+  ChickenSet live;
+};
+
+#endif
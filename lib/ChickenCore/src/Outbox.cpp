@@ -0,0 +1,60 @@
+#include "Outbox.h"
+
+Outbox::Outbox() : head(0), count(0), inFlight(0), dropped(0), spill(nullptr) {
+}
+
+void Outbox::push(const OutboxRecord& record) {
+  // Once anything is spilled, newer records must queue behind it to keep FIFO order
+  bool spilling = spill && spill->size() > 0;
+
+  if (!spilling && count < OUTBOX_CAPACITY) {
+    records[(head + count) % OUTBOX_CAPACITY] = record;
+    count++;
+    return;
+  }
+
+  if (spill && spill->append(record)) {
+    return;
+  }
+
+  if (spilling) {
+    dropped++; // Spill full: the new record can't jump the queue, so it is the one lost
+    return;
+  }
+
+  // RAM full, no spill: drop the oldest record that is not in flight (those may be delivered)
+  dropped++;
+  if (inFlight >= count) return;
+  for (uint16_t i = inFlight; i > 0; i--) {
+    records[(head + i) % OUTBOX_CAPACITY] = records[(head + i - 1) % OUTBOX_CAPACITY];
+  }
+  head = (head + 1) % OUTBOX_CAPACITY;
+  count--;
+  records[(head + count) % OUTBOX_CAPACITY] = record;
+  count++;
+}
+
+void Outbox::pop() {
+  if (count) {
+    if (inFlight) inFlight--;
+    head = (head + 1) % OUTBOX_CAPACITY;
+    count--;
+  }
+  refill();
+}
+
+// Move spilled records back into RAM as it frees up. A spill that can't be read back is
+// dropped as a whole, so size() never reports records next() can't reach.
+void Outbox::refill() {
+  if (!spill) return;
+  while (count < OUTBOX_CAPACITY && spill->size() > 0) {
+    OutboxRecord record;
+    if (!spill->takeOldest(record)) {
+      dropped += spill->size();
+      spill->clear();
+      return;
+    }
+    records[(head + count) % OUTBOX_CAPACITY] = record;
+    count++;
+  }
+}
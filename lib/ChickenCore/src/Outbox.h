@@ -0,0 +1,81 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define OUTBOX_CAPACITY 64              // Records held in RAM
+#define OUTBOX_BATCH_SIZE 5             // Records published per batch interval
+#define OUTBOX_BATCH_INTERVAL_MS 1000   // So a backlog drains at 5 msg/s instead of flooding the broker
+
+enum OutboxKind : uint8_t {
+  OUTBOX_VISIT = 1,
+  OUTBOX_CHANGE = 2
+};
+
+// Compact pending event. The payload is built when the record is published,
+// using the original event time.
+struct OutboxRecord {
+  uint32_t timestampMs;  // HalClock time of the event
+  uint32_t duration;     // Seconds (visit duration / previous chicken's duration)
+  uint16_t chicken;      // Visiting / previous chicken handle
+  uint16_t other;        // New chicken handle for changes, NO_CHICKEN otherwise
+  uint8_t kind;          // OutboxKind
+  uint8_t reserved[3];
+};
+
+// Optional overflow storage (e.g. a flash file). Records go here when RAM is full
+// and come back in FIFO order as the RAM ring drains.
+class OutboxSpill {
+public:
+  virtual ~OutboxSpill() {}
+  virtual bool append(const OutboxRecord& record) = 0;
+  virtual bool takeOldest(OutboxRecord& record) = 0;
+  virtual uint32_t size() = 0;
+  // Forget everything stored (the spill could not be read back)
+  virtual void clear() = 0;
+};
+
+// Bounded store-and-forward queue for visit/change events, preallocated in RAM.
+// Records are sent oldest first and stay queued ("in flight") until the publisher confirms them.
+class Outbox {
+public:
+  Outbox();
+
+  // Records the spill kept from before (e.g. the previous boot) are queued right away
+  void setSpill(OutboxSpill* spillStore) {
+    spill = spillStore;
+    refill();
+  }
+
+  // Never fails: when RAM and spill are both full the oldest record not in flight is dropped
+  void push(const OutboxRecord& record);
+
+  // Oldest record not handed to the publisher yet (nullptr = none in RAM)
+  const OutboxRecord* next() const {
+    return inFlight < count ? &records[(head + inFlight) % OUTBOX_CAPACITY] : nullptr;
+  }
+  void markSent() { inFlight++; }
+  // The oldest record leaves the queue (delivered, or nothing to send)
+  void pop();
+  // n in-flight records were not delivered. Once none is in flight, next() starts again
+  // from the oldest record (the publisher sends nothing after a failure, see DeliveryReceipt)
+  void resend(uint32_t n) { inFlight = n < inFlight ? inFlight - n : 0; }
+  uint32_t inFlightCount() const { return inFlight; }
+
+  uint32_t size() const { return count + (spill ? spill->size() : 0); }
+  bool empty() const { return size() == 0; }
+  uint32_t droppedCount() const { return dropped; }
+
+private:
+  void refill();
+
+  OutboxRecord records[OUTBOX_CAPACITY];
+  uint16_t head;
+  uint16_t count;
+  uint16_t inFlight;
+  uint32_t dropped;
+  OutboxSpill* spill;
+};
+
+#endif
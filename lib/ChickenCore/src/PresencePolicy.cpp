@@ -0,0 +1,60 @@
+#include "PresencePolicy.h"
+
+PresencePolicy::PresencePolicy() : current(ADAPTIVE) {
+  for (int c = 0; c < MAX_CHICKENS; c++) {
+    for (int b = 0; b < DWELL_BUCKETS; b++) dwell[c][b] = 0;
+  }
+}
+
+int PresencePolicy::bucketOf(unsigned long seconds) {
+  int bucket = 0;
+  while (bucket < DWELL_BUCKETS - 1 && seconds >= ((unsigned long)DWELL_BUCKET_BASE_S << bucket)) bucket++;
+  return bucket;
+}
+
+void PresencePolicy::recordDwell(ChickenHandle chicken, unsigned long seconds) {
+  if (chicken >= MAX_CHICKENS) return;
+  uint16_t* counts = dwell[chicken];
+  counts[bucketOf(seconds)]++;
+
+  unsigned total = 0;
+  for (int b = 0; b < DWELL_BUCKETS; b++) total += counts[b];
+  if (total >= DWELL_DECAY_TOTAL) {
+    for (int b = 0; b < DWELL_BUCKETS; b++) counts[b] = (counts[b] + 1) / 2; // Keep rare buckets alive
+  }
+}
+
+static unsigned long clampProbe(unsigned long ms) {
+  if (ms < PRESENCE_PROBE_MIN_MS) return PRESENCE_PROBE_MIN_MS;
+  if (ms > PRESENCE_PROBE_MAX_MS) return PRESENCE_PROBE_MAX_MS;
+  return ms;
+}
+
+unsigned long PresencePolicy::probeInterval(ChickenHandle chicken, unsigned long elapsedMs, bool multipleChickens) const {
+  if (current == FIXED || chicken >= MAX_CHICKENS) return PRESENCE_PROBE_FIXED_MS;
+  if (multipleChickens || elapsedMs < PRESENCE_ENTRY_PHASE_MS) return PRESENCE_PROBE_MIN_MS;
+
+  const uint16_t* counts = dwell[chicken];
+  unsigned total = 0;
+  for (int b = 0; b < DWELL_BUCKETS; b++) total += counts[b];
+  if (total < DWELL_MIN_SAMPLES) return PRESENCE_PROBE_FIXED_MS;
+
+  // Visits that lasted at least as long as this one has so far
+  unsigned long elapsedS = elapsedMs / 1000;
+  int bucket = bucketOf(elapsedS);
+  unsigned remaining = 0;
+  for (int b = bucket; b < DWELL_BUCKETS; b++) remaining += counts[b];
+  if (remaining == 0) return PRESENCE_PROBE_MAX_MS; // Longer than any visit seen: a laying sit
+
+  if (counts[bucket] == 0) {
+    // No exits expected in this bucket: next probe where the next recorded exits start
+    int next = bucket + 1;
+    while (counts[next] == 0) next++; // remaining > 0 guarantees one
+    return clampProbe((bucketStart(next) - elapsedS) * 1000);
+  }
+
+  // Exit chance per second in this bucket = hazard / width; probe at the target chance
+  unsigned long widthS = bucket == 0 ? DWELL_BUCKET_BASE_S : bucketStart(bucket);
+  unsigned long intervalMs = (unsigned long)PRESENCE_TARGET_EXIT_PERCENT * widthS * 10 * remaining / counts[bucket];
+  return clampProbe(intervalMs);
+}
@@ -0,0 +1,52 @@
+#ifndef PRESENCE_POLICY_H
+#define PRESENCE_POLICY_H
+
+#include "ChickenDatabase.h"
+
+// Decides how often an occupied nest is probed (reader reset + exit window).
+// Every probe costs a reset; every second between probes adds to exit latency.
+//
+// FIXED probes every PRESENCE_PROBE_FIXED_MS (the original behaviour).
+// ADAPTIVE learns each chicken's visit lengths and probes when an exit is likely:
+// often right after entry and while several chickens are in the nest, rarely deep into a sit
+// that is already longer than the chicken's usual visits (laying).
+
+#define PRESENCE_PROBE_FIXED_MS 30000UL
+#define PRESENCE_PROBE_MIN_MS 10000UL          // Right after entry, multi-chicken activity
+#define PRESENCE_PROBE_MAX_MS 120000UL         // Long sits
+#define PRESENCE_ENTRY_PHASE_MS 60000UL        // Probe at the minimum interval this long after entry
+#define PRESENCE_TARGET_EXIT_PERCENT 20        // Aim for this chance of an exit between two probes
+
+// Per-chicken visit length histogram: bucket 0 < 30 s, bucket i < 30 s << i, last bucket open-ended
+#define DWELL_BUCKETS 10
+#define DWELL_BUCKET_BASE_S 30
+#define DWELL_MIN_SAMPLES 4                    // Use FIXED until a chicken has this many visits
+#define DWELL_DECAY_TOTAL 64                   // Halve a chicken's counts at this total: recent visits weigh more
+
+class PresencePolicy {
+public:
+  enum Mode {
+    FIXED,
+    ADAPTIVE
+  };
+
+  PresencePolicy();
+
+  void setMode(Mode policyMode) { current = policyMode; }
+  Mode mode() const { return current; }
+
+  // A visit of this chicken ended after 'seconds'
+  void recordDwell(ChickenHandle chicken, unsigned long seconds);
+
+  // Time from the last confirmation to the next probe for a chicken in the nest for 'elapsedMs'
+  unsigned long probeInterval(ChickenHandle chicken, unsigned long elapsedMs, bool multipleChickens) const;
+
+private:
+  static int bucketOf(unsigned long seconds);
+  static unsigned long bucketStart(int bucket) { return bucket == 0 ? 0 : (unsigned long)DWELL_BUCKET_BASE_S << (bucket - 1); }
+
+  Mode current;
+  uint16_t dwell[MAX_CHICKENS][DWELL_BUCKETS];
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include "PublishQueue.h"
+#include <stdio.h>
+#include <string.h>
+
+bool QueuedPublisher::enqueue(const char* topic, const uint8_t* payload, size_t length, bool binary,
+                              DeliveryReceipt* receipt) {
+  if (binary && length > sizeof(PublishMessage::payload)) {
+    dropped.fetch_add(1, std::memory_order_relaxed); // Truncated binary is useless
+    return false;
+  }
+  PublishMessage* message = ring.acquire();
+  if (!message) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  snprintf(message->topic, sizeof(message->topic), "%s", topic);
+  if (binary) {
+    memcpy(message->payload, payload, length);
+    message->length = length;
+  } else {
+    int written = snprintf(message->payload, sizeof(message->payload), "%s", (const char*)payload);
+    message->length = written < (int)sizeof(message->payload) ? written : sizeof(message->payload) - 1;
+  }
+  message->receipt = receipt;
+  ring.commit();
+  return true;
+}
+
+bool QueuedPublisher::publish(const char* topic, const char* payload) {
+  return enqueue(topic, (const uint8_t*)payload, 0, false, nullptr);
+}
+
+bool QueuedPublisher::publish(const char* topic, const uint8_t* payload, size_t length) {
+  return enqueue(topic, payload, length, true, nullptr);
+}
+
+bool QueuedPublisher::publishConfirmed(const char* topic, const uint8_t* payload, size_t length, bool binary,
+                                       DeliveryReceipt& receipt) {
+  return enqueue(topic, payload, length, binary, &receipt);
+}
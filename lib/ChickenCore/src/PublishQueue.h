@@ -0,0 +1,46 @@
+#ifndef PUBLISH_QUEUE_H
+#define PUBLISH_QUEUE_H
+
+#include "Hal.h"
+#include "SpscRing.h"
+#include <atomic>
+
+#define PUBLISH_TOPIC_MAX 64
+#define PUBLISH_PAYLOAD_MAX 1024 // Largest payload the tracker builds (leaderboard)
+#define PUBLISH_QUEUE_SIZE 16
+
+struct PublishMessage {
+  char topic[PUBLISH_TOPIC_MAX];
+  char payload[PUBLISH_PAYLOAD_MAX];
+  uint16_t length; // Payload bytes (binary payloads are not terminated)
+  DeliveryReceipt* receipt; // Where the network task reports the outcome (nullptr = fire and forget)
+};
+
+typedef SpscRing<PublishMessage, PUBLISH_QUEUE_SIZE> PublishRing;
+
+// HalPublisher for the tracker task: publish() copies the message into a lock-free ring
+// that the network task drains into the real MQTT client. Never blocks.
+class QueuedPublisher : public HalPublisher {
+public:
+  explicit QueuedPublisher(PublishRing& ring) : ring(ring), online(false), dropped(0) {}
+
+  // Connection state is mirrored by the network task
+  bool connected() override { return online.load(std::memory_order_relaxed); }
+  bool publish(const char* topic, const char* payload) override;
+  bool publish(const char* topic, const uint8_t* payload, size_t length) override;
+  // Queued with the receipt; the network task counts it delivered or failed when it sends it
+  bool publishConfirmed(const char* topic, const uint8_t* payload, size_t length, bool binary,
+                        DeliveryReceipt& receipt) override;
+
+  void setConnected(bool state) { online.store(state, std::memory_order_relaxed); }
+  uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  bool enqueue(const char* topic, const uint8_t* payload, size_t length, bool binary, DeliveryReceipt* receipt);
+
+  PublishRing& ring;
+  std::atomic<bool> online;
+  std::atomic<uint32_t> dropped;
+};
+
+#endif
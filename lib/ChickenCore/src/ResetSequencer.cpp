@@ -0,0 +1,65 @@
+#include "ResetSequencer.h"
+#include <limits.h>
+
+ResetSequencer::ResetSequencer(unsigned long holdMs, unsigned long settleMs)
+  : pin(nullptr), holdMs(holdMs), settleMs(settleMs), current(LISTENING), phaseStart(0),
+    assertedAt(0), releasedAt(0), resets(0) {
+}
+
+void ResetSequencer::begin(HalResetPin* resetPin) {
+  pin = resetPin;
+  current = LISTENING;
+  pin->write(true); // Keep reader active
+}
+
+void ResetSequencer::start(unsigned long now) {
+  pin->write(false); // Reset the reader
+  current = ASSERTING;
+  phaseStart = now;
+  assertedAt = now;
+  resets++;
+}
+
+ResetSequencer::Event ResetSequencer::update(unsigned long now) {
+  switch (current) {
+    case ASSERTING:
+      if (now - phaseStart < holdMs) return NO_EVENT;
+      current = RELEASING;
+      // fall through
+    case RELEASING:
+      pin->write(true); // Release reset
+      current = SETTLING;
+      phaseStart = now;
+      releasedAt = now;
+      return RELEASED;
+    case SETTLING:
+      if (now - phaseStart < settleMs) return NO_EVENT;
+      current = LISTENING;
+      return SETTLED;
+    case LISTENING:
+    default:
+      return NO_EVENT;
+  }
+}
+
+unsigned long ResetSequencer::msUntilUpdate(unsigned long now) const {
+  unsigned long elapsed = now - phaseStart;
+  switch (current) {
+    case ASSERTING:
+      return elapsed >= holdMs ? 0 : holdMs - elapsed;
+    case RELEASING:
+      return 0;
+    case SETTLING:
+      return elapsed >= settleMs ? 0 : settleMs - elapsed;
+    case LISTENING:
+    default:
+      return ULONG_MAX;
+  }
+}
+
+bool ResetSequencer::acceptsReadAt(unsigned long readTime, bool probePending) const {
+  if (resets == 0) return true;
+  if ((long)(readTime - assertedAt) < 0) return !probePending; // Completed before the reset started
+  if (current == ASSERTING) return false;
+  return (long)(readTime - releasedAt) >= 0;
+}
@@ -0,0 +1,56 @@
+#ifndef RESET_SEQUENCER_H
+#define RESET_SEQUENCER_H
+
+#include "Hal.h"
+
+// EL125 reset timing
+#define RFID_RESET_HOLD_MS 200     // RES held low - long enough for a complete power cycle
+#define RFID_RESET_SETTLE_MS 1000  // Restart time for the EL125 to stabilize and begin scanning
+
+// Non-blocking reader reset: asserting -> releasing -> settling -> listening.
+// start() pulls RES low and returns immediately; update() is called every loop pass
+// and advances the sequence when its deadline has passed.
+class ResetSequencer {
+public:
+  enum Phase {
+    LISTENING,  // Idle, reader running normally
+    ASSERTING,  // RES held low
+    RELEASING,  // RES being released (transient, passed through inside update())
+    SETTLING    // Reader restarting; its first frames may already arrive
+  };
+
+  enum Event {
+    NO_EVENT,
+    RELEASED,   // RES went high during this update()
+    SETTLED     // Settle time elapsed during this update(), reader is listening again
+  };
+
+  ResetSequencer(unsigned long holdMs = RFID_RESET_HOLD_MS, unsigned long settleMs = RFID_RESET_SETTLE_MS);
+
+  void begin(HalResetPin* pin);
+  void start(unsigned long now);
+  Event update(unsigned long now);
+
+  Phase phase() const { return current; }
+  bool busy() const { return current != LISTENING; }
+  // Frames are only trustworthy if they completed before RES went low or after it was released.
+  // Works on read timestamps so frames queued by another task are judged correctly.
+  // While a probe waits for its answer (probePending), frames read before RES went low are
+  // rejected too: a read queued before the reset must not confirm presence.
+  bool acceptsReadAt(unsigned long readTime, bool probePending) const;
+  uint32_t resetCount() const { return resets; }
+  // Time until update() has the next phase change to make (ULONG_MAX when listening)
+  unsigned long msUntilUpdate(unsigned long now) const;
+
+private:
+  HalResetPin* pin;
+  unsigned long holdMs;
+  unsigned long settleMs;
+  Phase current;
+  unsigned long phaseStart;
+  unsigned long assertedAt;
+  unsigned long releasedAt;
+  uint32_t resets;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Lock-free single-producer / single-consumer ring buffer.
+// Exactly one task may call the producer side (push/acquire/commit) and exactly one
+// the consumer side (pop/peek/release). SIZE must be a power of two.
+template <typename T, uint32_t SIZE>
+class SpscRing {
+  static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  SpscRing() : head(0), tail(0) {}
+
+  // Producer: copy an item in. Returns false when full.
+  bool push(const T& item) {
+    T* slot = acquire();
+    if (!slot) return false;
+    *slot = item;
+    commit();
+    return true;
+  }
+
+  // Producer: get the next free slot to fill in place (nullptr when full), then commit() it
+  T* acquire() {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= SIZE) return nullptr;
+    return &items[h & (SIZE - 1)];
+  }
+
+  void commit() {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Consumer: copy the oldest item out. Returns false when empty.
+  bool pop(T& item) {
+    T* slot = peek();
+    if (!slot) return false;
+    item = *slot;
+    release();
+    return true;
+  }
+
+  // Consumer: look at the oldest item in place (nullptr when empty), then release() it
+  T* peek() {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) return nullptr;
+    return &items[t & (SIZE - 1)];
+  }
+
+  void release() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Approximate when called from a third party; exact from either end
+  uint32_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  static uint32_t capacity() { return SIZE; }
+
+private:
+  T items[SIZE];
+  std::atomic<uint32_t> head; // Next slot to write (producer owned)
+  std::atomic<uint32_t> tail; // Next slot to read (consumer owned)
+};
+
+#endif
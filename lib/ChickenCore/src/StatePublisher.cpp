@@ -0,0 +1,56 @@
+#include "StatePublisher.h"
+#include "Crc32.h"
+#include <string.h>
+
+StatePublisher::StatePublisher() : slots(), staged(0), sent(0), skipped(0) {
+}
+
+void StatePublisher::setTopic(int slot, const char* topic, bool event) {
+  slots[slot].topic = topic;
+  slots[slot].event = event;
+  slots[slot].hasSent = false;
+  staged &= ~(1UL << slot);
+}
+
+void StatePublisher::set(int slot, const void* value, size_t length, bool binary, uint32_t key) {
+  Slot& s = slots[slot];
+  if (length > STATE_VALUE_MAX) length = STATE_VALUE_MAX; // Text only: binary payloads are built smaller
+  memcpy(s.value, value, length);
+  s.value[length] = '\0';
+  s.length = length;
+  s.binary = binary;
+  s.key = key != 0 ? key : crc32(value, length);
+  staged |= 1UL << slot;
+}
+
+void StatePublisher::set(int slot, const char* value, uint32_t key) {
+  set(slot, value, strlen(value), false, key);
+}
+
+uint32_t StatePublisher::flush(HalPublisher* publisher) {
+  uint32_t sentSlots = 0;
+  if (staged == 0 || !publisher->connected()) return 0;
+
+  for (int i = 0; i < STATE_SLOTS; i++) {
+    Slot& s = slots[i];
+    if (!(staged & (1UL << i))) continue;
+
+    if (!s.event && s.hasSent && s.key == s.sentKey) {
+      skipped++;
+    } else {
+      bool ok = s.binary ? publisher->publish(s.topic, (const uint8_t*)s.value, s.length)
+                         : publisher->publish(s.topic, s.value);
+      if (!ok) continue; // Retry with the next flush
+      s.sentKey = s.key;
+      s.hasSent = true;
+      sentSlots |= 1UL << i;
+      sent++;
+    }
+    staged &= ~(1UL << i);
+  }
+  return sentSlots;
+}
+
+void StatePublisher::invalidate() {
+  for (Slot& s : slots) s.hasSent = false;
+}
@@ -0,0 +1,59 @@
+#ifndef STATE_PUBLISHER_H
+#define STATE_PUBLISHER_H
+
+#include "Hal.h"
+
+#define STATE_SLOTS 4           // Topics per publisher
+#define STATE_VALUE_MAX 512     // Largest staged payload (multi-chicken status)
+
+// Coalesces state topics: values are staged with set() while a tracker pass runs and
+// flush() sends each topic once at the end, and only if it differs from what was last
+// sent. A value is compared by a key, so fields that always change (timestamps, read
+// confidence) need not cause a publish. Event slots are sent whenever staged.
+class StatePublisher {
+public:
+  StatePublisher();
+
+  // Slots must be given a topic before use; the topic string must outlive the publisher
+  void setTopic(int slot, const char* topic, bool event = false);
+
+  // Stage a value. key identifies the state it represents (0 = CRC of the value itself).
+  void set(int slot, const void* value, size_t length, bool binary = false, uint32_t key = 0);
+  void set(int slot, const char* value, uint32_t key = 0);
+
+  // Send every staged value whose key differs from the last one sent. A failed publish
+  // stays staged for the next flush. Returns a bit per slot that was sent.
+  uint32_t flush(HalPublisher* publisher);
+
+  // Forget what was sent: the next flush sends every staged value (heartbeat, reconnect)
+  void invalidate();
+
+  bool pending() const { return staged != 0; }
+
+  const char* topic(int slot) const { return slots[slot].topic; }
+  const char* value(int slot) const { return slots[slot].value; }
+  size_t length(int slot) const { return slots[slot].length; }
+  bool binary(int slot) const { return slots[slot].binary; }
+
+  uint32_t sentCount() const { return sent; }
+  uint32_t skippedCount() const { return skipped; } // Staged but equal to what was sent
+
+private:
+  struct Slot {
+    const char* topic;
+    bool event;
+    bool binary;
+    bool hasSent;          // sentKey is valid
+    uint32_t key;          // Of the staged value
+    uint32_t sentKey;
+    size_t length;
+    char value[STATE_VALUE_MAX + 1]; // Text values are terminated
+  };
+
+  Slot slots[STATE_SLOTS];
+  uint32_t staged;         // Bit per slot with a value waiting for flush()
+  uint32_t sent;
+  uint32_t skipped;
+};
+
+#endif
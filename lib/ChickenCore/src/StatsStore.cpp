@@ -0,0 +1,123 @@
+#include "StatsStore.h"
+#include "Crc32.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+uint8_t StatsStore::buffer[STATS_RECORD_MAX];
+
+void StatsStore::begin(HalStorage* storageImpl, const char* keySuffix) {
+  storage = storageImpl;
+  snprintf(keys[0], sizeof(keys[0]), "stats_a%s", keySuffix);
+  snprintf(keys[1], sizeof(keys[1]), "stats_b%s", keySuffix);
+  sequence = 0;
+  dirtyVisits = 0;
+}
+
+// Read and check one record into buffer; sequence is set when it is valid
+bool StatsStore::loadRecord(const char* key, uint32_t& recordSequence) {
+  size_t length = storage->load(key, buffer, sizeof(buffer));
+  if (length < sizeof(StatsRecordHeader)) return false;
+
+  StatsRecordHeader header;
+  memcpy(&header, buffer, sizeof(header));
+  if (header.magic != STATS_MAGIC || header.version != STATS_FORMAT_VERSION) return false;
+  if (header.count > MAX_CHICKENS) return false;
+  if (length != sizeof(header) + header.count * sizeof(StatsRecordEntry)) return false;
+  if (crc32(buffer + sizeof(header), header.count * sizeof(StatsRecordEntry)) != header.crc) return false;
+
+  recordSequence = header.sequence;
+  return true;
+}
+
+bool StatsStore::restore(ChickenStats* stats, int count) {
+  if (!storage) return false;
+
+  // Pick the newer of the two records
+  uint32_t sequences[2];
+  bool valid[2];
+  for (int i = 0; i < 2; i++) {
+    valid[i] = loadRecord(keys[i], sequences[i]);
+  }
+  int newest;
+  if (valid[0] && valid[1]) {
+    newest = (int32_t)(sequences[1] - sequences[0]) > 0 ? 1 : 0;
+  } else if (valid[0] || valid[1]) {
+    newest = valid[0] ? 0 : 1;
+  } else {
+    return false;
+  }
+  if (!loadRecord(keys[newest], sequence)) return false; // Reload into buffer
+
+  StatsRecordHeader header;
+  memcpy(&header, buffer, sizeof(header));
+  for (int i = 0; i < header.count; i++) {
+    StatsRecordEntry entry;
+    memcpy(&entry, buffer + sizeof(header) + i * sizeof(entry), sizeof(entry));
+    ChickenHandle handle = findChickenHandle(entry.tag);
+    if (handle == NO_CHICKEN || handle >= count) continue; // Chicken removed since the save
+    stats[handle].visits = entry.visits;
+    stats[handle].totalTime = entry.totalTime;
+    stats[handle].lastVisit = 0;
+  }
+  return true;
+}
+
+void StatsStore::markDirty(unsigned long now) {
+  if (dirtyVisits == 0) dirtySince = now;
+  dirtyVisits++;
+}
+
+bool StatsStore::flushDue(unsigned long now) const {
+  if (dirtyVisits == 0) return false;
+  return dirtyVisits >= STATS_FLUSH_VISITS || now - dirtySince >= STATS_FLUSH_INTERVAL_MS;
+}
+
+unsigned long StatsStore::msUntilFlush(unsigned long now) const {
+  if (dirtyVisits == 0) return ULONG_MAX;
+  unsigned long elapsed = now - dirtySince;
+  return elapsed >= STATS_FLUSH_INTERVAL_MS ? 0 : STATS_FLUSH_INTERVAL_MS - elapsed;
+}
+
+bool StatsStore::flush(const ChickenStats* stats, int count, unsigned long now) {
+  if (!storage) {
+    dirtyVisits = 0;
+    return false;
+  }
+  if (count > MAX_CHICKENS) count = MAX_CHICKENS;
+
+  uint8_t* entries = buffer + sizeof(StatsRecordHeader);
+  int written = 0;
+  for (int i = 0; i < count; i++) {
+    const Chicken* chicken = chickenByHandle((ChickenHandle)i);
+    if (!chicken) continue; // Free registry number
+    StatsRecordEntry entry;
+    entry.tag = chicken->tagID;
+    entry.visits = (uint32_t)stats[i].visits;
+    entry.totalTime = (uint32_t)stats[i].totalTime;
+    memcpy(entries + written * sizeof(entry), &entry, sizeof(entry));
+    written++;
+  }
+  count = written;
+
+  StatsRecordHeader header;
+  header.magic = STATS_MAGIC;
+  header.version = STATS_FORMAT_VERSION;
+  header.count = (uint16_t)count;
+  header.sequence = sequence + 1;
+  header.crc = crc32(entries, count * sizeof(StatsRecordEntry));
+  memcpy(buffer, &header, sizeof(header));
+
+  // Even sequence numbers go to stats_a<suffix>, odd ones to stats_b<suffix>
+  size_t length = sizeof(header) + count * sizeof(StatsRecordEntry);
+  if (!storage->save(keys[header.sequence & 1], buffer, length)) {
+    // Keep the stats dirty but back off to the next batch instead of retrying every pass
+    dirtyVisits = 1;
+    dirtySince = now;
+    return false;
+  }
+  sequence = header.sequence;
+  saves++;
+  dirtyVisits = 0;
+  return true;
+}
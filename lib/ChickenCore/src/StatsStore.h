@@ -0,0 +1,69 @@
+#ifndef STATS_STORE_H
+#define STATS_STORE_H
+
+#include "Hal.h"
+#include "ChickenDatabase.h"
+#include "ChickenStats.h"
+
+// Keeps the scoring stats across reboots.
+// Saves are batched: a record is written after STATS_FLUSH_VISITS visits, or
+// STATS_FLUSH_INTERVAL_MS after the first unsaved visit, whichever comes first.
+// Two keys are written alternately, so a save interrupted by a brownout
+// still leaves the previous record intact, and each key sees half the writes.
+
+#define STATS_FLUSH_VISITS 10
+#define STATS_FLUSH_INTERVAL_MS 900000UL // 15 minutes
+#define STATS_FORMAT_VERSION 1
+#define STATS_MAGIC 0x53544B43 // "CKTS"
+#define STATS_KEY_MAX 16         // Storage key incl. terminator (NVS allows 15 characters)
+
+// On-flash layout (little endian, fixed size per entry)
+struct StatsRecordHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;    // Entries following the header
+  uint32_t sequence; // Newer record wins on restore
+  uint32_t crc;      // CRC-32 of the entries
+};
+
+struct StatsRecordEntry {
+  TagId tag;         // Entries are matched by tag, so reordering the database is safe
+  uint32_t visits;
+  uint32_t totalTime; // Seconds
+};
+
+// Largest record; each nest stores two of them
+#define STATS_RECORD_MAX (sizeof(StatsRecordHeader) + MAX_CHICKENS * sizeof(StatsRecordEntry))
+
+class StatsStore {
+public:
+  // keySuffix tells the records of several nests sharing one storage apart ("" = first nest)
+  void begin(HalStorage* storage, const char* keySuffix = "");
+
+  // Load the newest valid record into stats[] (count entries, indexed by chicken handle).
+  // Returns false when nothing usable was stored; stats[] is left untouched then.
+  bool restore(ChickenStats* stats, int count);
+
+  // Record that stats changed; flushDue() says when a save is worth the flash write
+  void markDirty(unsigned long now);
+  bool flushDue(unsigned long now) const;
+  // Time until a flush is due with no further visits (ULONG_MAX when clean)
+  unsigned long msUntilFlush(unsigned long now) const;
+  bool flush(const ChickenStats* stats, int count, unsigned long now);
+
+  uint32_t saveCount() const { return saves; }
+
+private:
+  bool loadRecord(const char* key, uint32_t& sequence);
+
+  HalStorage* storage = nullptr;
+  uint32_t sequence = 0;
+  uint32_t saves = 0;
+  int dirtyVisits = 0;
+  unsigned long dirtySince = 0;
+  char keys[2][STATS_KEY_MAX];
+  // Record being loaded or saved, shared by all stores (they run on the same task)
+  static uint8_t buffer[STATS_RECORD_MAX];
+};
+
+#endif
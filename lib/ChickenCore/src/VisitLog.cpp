@@ -0,0 +1,193 @@
+#include "VisitLog.h"
+#include "Crc32.h"
+#include <limits.h>
+
+static uint16_t recordCheck(const VisitLogRecord& record) {
+  return (uint16_t)crc32(&record, offsetof(VisitLogRecord, check));
+}
+
+bool VisitLog::readRecord(uint32_t segment, uint32_t index, VisitLogRecord& record) {
+  return files->read(segment, index * sizeof(record), &record, sizeof(record)) == sizeof(record);
+}
+
+bool VisitLog::begin(VisitLogFiles* filesImpl) {
+  files = filesImpl;
+  segmentCount = 0;
+  tailWritable = false;
+  latest = 0;
+  pendingCount = 0;
+  if (!files) return false;
+
+  uint32_t first, last;
+  if (files->range(first, last)) {
+    // Keep the newest segments, drop the rest (e.g. after lowering VISIT_LOG_MAX_SEGMENTS)
+    if (last - first >= VISIT_LOG_MAX_SEGMENTS) {
+      for (uint32_t id = first; id <= last - VISIT_LOG_MAX_SEGMENTS; id++) files->remove(id);
+      first = last - VISIT_LOG_MAX_SEGMENTS + 1;
+    }
+
+    for (uint32_t id = first; id <= last; id++) {
+      uint32_t bytes = files->size(id);
+      Segment segment = { id, bytes / (uint32_t)sizeof(VisitLogRecord), 0, 0 };
+      tailWritable = bytes % sizeof(VisitLogRecord) == 0;
+
+      // Drop a torn or corrupt tail record from the index
+      VisitLogRecord record;
+      while (segment.count > 0 && (!readRecord(id, segment.count - 1, record) || record.check != recordCheck(record))) {
+        segment.count--;
+        tailWritable = false;
+      }
+      if (segment.count == 0) continue;
+      segment.lastTime = record.time;
+      if (!readRecord(id, 0, record)) continue;
+      segment.firstTime = record.time;
+      segments[segmentCount++] = segment;
+      latest = segment.lastTime;
+    }
+    if (segmentCount == 0 || segments[segmentCount - 1].id != last) tailWritable = false;
+  }
+
+  bootBase = latest ? latest + 1 : 0;
+  return true;
+}
+
+uint32_t VisitLog::timeNow(unsigned long uptimeMs, uint32_t epochSeconds, uint8_t& flags) const {
+  uint32_t time = epochSeconds;
+  if (time == 0) {
+    time = bootBase + (uint32_t)(uptimeMs / 1000);
+    flags |= VISIT_LOG_TIME_ESTIMATED;
+  }
+  return time < latest ? latest : time;
+}
+
+// Start a new segment after the newest one, rotating out the oldest when full
+void VisitLog::openSegment() {
+  uint32_t id = segmentCount ? segments[segmentCount - 1].id + 1 : 0;
+  if (segmentCount == 0) {
+    uint32_t first, last;
+    if (files->range(first, last)) id = last + 1; // Don't reuse a number with leftovers
+  }
+
+  if (segmentCount == VISIT_LOG_MAX_SEGMENTS) {
+    files->remove(segments[0].id);
+    for (int i = 1; i < segmentCount; i++) segments[i - 1] = segments[i];
+    segmentCount--;
+  }
+
+  Segment segment = { id, 0, 0, 0 };
+  segments[segmentCount++] = segment;
+  tailWritable = true;
+}
+
+// Write records to the tail segment(s) with one file append per segment
+bool VisitLog::write(const VisitLogRecord* records, uint32_t count) {
+  while (count > 0) {
+    if (segmentCount == 0 || !tailWritable || segments[segmentCount - 1].count >= VISIT_LOG_SEGMENT_RECORDS) {
+      openSegment();
+    }
+
+    Segment& tail = segments[segmentCount - 1];
+    uint32_t room = VISIT_LOG_SEGMENT_RECORDS - tail.count;
+    uint32_t batch = count < room ? count : room;
+    if (!files->append(tail.id, records, batch * sizeof(VisitLogRecord))) {
+      tailWritable = false; // Unknown how much was written
+      if (tail.count == 0) {
+        files->remove(tail.id);
+        segmentCount--;
+      }
+      return false;
+    }
+
+    if (tail.count == 0) tail.firstTime = records[0].time;
+    tail.lastTime = records[batch - 1].time;
+    tail.count += batch;
+    records += batch;
+    count -= batch;
+  }
+  return true;
+}
+
+bool VisitLog::append(VisitLogRecord& record, unsigned long now) {
+  if (!files) return false;
+  record.check = recordCheck(record);
+
+  bool written = pendingCount < VISIT_LOG_WRITE_BATCH || flush();
+  if (pendingCount == 0) pendingSince = now;
+  pending[pendingCount++] = record;
+  if (record.time > latest) latest = record.time;
+  return written;
+}
+
+bool VisitLog::flushDue(unsigned long now) const {
+  if (pendingCount == 0) return false;
+  return pendingCount >= VISIT_LOG_WRITE_BATCH || now - pendingSince >= VISIT_LOG_FLUSH_INTERVAL_MS;
+}
+
+unsigned long VisitLog::msUntilFlush(unsigned long now) const {
+  if (pendingCount == 0) return ULONG_MAX;
+  unsigned long elapsed = now - pendingSince;
+  return elapsed >= VISIT_LOG_FLUSH_INTERVAL_MS ? 0 : VISIT_LOG_FLUSH_INTERVAL_MS - elapsed;
+}
+
+bool VisitLog::flush() {
+  if (!files || pendingCount == 0) return true;
+  uint32_t count = pendingCount;
+  pendingCount = 0;
+  return write(pending, count);
+}
+
+// Binary search for the first record with time >= time
+uint32_t VisitLog::firstAtOrAfter(const Segment& segment, uint32_t time) {
+  uint32_t low = 0;
+  uint32_t high = segment.count;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    VisitLogRecord record;
+    if (!readRecord(segment.id, mid, record)) return segment.count;
+    if (record.time < time) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+uint32_t VisitLog::query(uint32_t from, uint32_t to, ChickenHandle chicken, VisitLogVisitor visitor, void* context) {
+  if (!files) return 0;
+  flush();
+
+  uint32_t matched = 0;
+  for (int s = 0; s < segmentCount; s++) {
+    const Segment& segment = segments[s];
+    if (segment.count == 0 || segment.lastTime < from) continue;
+    if (segment.firstTime >= to) break;
+
+    uint32_t index = segment.firstTime >= from ? 0 : firstAtOrAfter(segment, from);
+    while (index < segment.count) {
+      VisitLogRecord chunk[VISIT_LOG_READ_CHUNK];
+      uint32_t wanted = segment.count - index;
+      if (wanted > VISIT_LOG_READ_CHUNK) wanted = VISIT_LOG_READ_CHUNK;
+      size_t bytes = files->read(segment.id, index * sizeof(VisitLogRecord), chunk, wanted * sizeof(VisitLogRecord));
+      uint32_t got = bytes / sizeof(VisitLogRecord);
+      if (got == 0) break;
+
+      for (uint32_t i = 0; i < got; i++) {
+        const VisitLogRecord& record = chunk[i];
+        if (record.time >= to) return matched;
+        if (record.check != recordCheck(record)) continue;
+        if (chicken != NO_CHICKEN && record.chicken != chicken && record.other != chicken) continue;
+        matched++;
+        if (!visitor(record, context)) return matched;
+      }
+      index += got;
+    }
+  }
+  return matched;
+}
+
+uint32_t VisitLog::size() const {
+  uint32_t total = 0;
+  for (int i = 0; i < segmentCount; i++) total += segments[i].count;
+  return total + pendingCount;
+}
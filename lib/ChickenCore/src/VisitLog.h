@@ -0,0 +1,103 @@
+#ifndef VISIT_LOG_H
+#define VISIT_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ChickenDatabase.h"
+
+// On-device visit history: an append-only log of fixed-size records split into segments.
+// Records are appended in time order, so each segment covers one time range and a query
+// only touches segments that overlap it (binary search inside the first one).
+// When the log is full the oldest segment is deleted.
+// Appends are buffered in RAM and written as one batch: when VISIT_LOG_WRITE_BATCH records
+// are waiting, or when the owner calls flush() once flushDue() (it does so while the nest is
+// empty, off the tracking path). A power cut loses at most the unwritten batch.
+
+#define VISIT_LOG_SEGMENT_RECORDS 1024   // 16 KB per segment
+#define VISIT_LOG_MAX_SEGMENTS 8         // 8192 visits/changes, months of history
+#define VISIT_LOG_READ_CHUNK 16          // Records read per file access during a query
+#define VISIT_LOG_WRITE_BATCH 16         // Records buffered before a write is forced
+#define VISIT_LOG_FLUSH_INTERVAL_MS 300000UL // Oldest buffered record waits at most this long (5 minutes)
+
+// VisitLogRecord::flags
+#define VISIT_LOG_TIME_ESTIMATED 0x01    // No wall clock yet: time continues from the previous record
+
+struct VisitLogRecord {
+  uint32_t time;       // Seconds (Unix time when known): end of the visit / moment of the change
+  uint32_t duration;   // Seconds; the visit started at time - duration
+  uint16_t chicken;    // Visiting / previous chicken handle
+  uint16_t other;      // New chicken handle for changes, NO_CHICKEN otherwise
+  uint8_t kind;        // OutboxKind
+  uint8_t flags;
+  uint16_t check;      // Low half of the CRC-32 of the fields above (catches torn writes)
+};
+
+static_assert(sizeof(VisitLogRecord) == 16, "VisitLogRecord is an on-flash format");
+
+// Segment files, numbered in append order (e.g. /visits/00000012.seg on LittleFS)
+class VisitLogFiles {
+public:
+  virtual ~VisitLogFiles() {}
+  // Lowest and highest segment number present, false when there are none
+  virtual bool range(uint32_t& first, uint32_t& last) = 0;
+  virtual uint32_t size(uint32_t segment) = 0; // Bytes, 0 when missing
+  virtual size_t read(uint32_t segment, uint32_t offset, void* data, size_t size) = 0;
+  virtual bool append(uint32_t segment, const void* data, size_t size) = 0;
+  virtual bool remove(uint32_t segment) = 0;
+};
+
+// Called for every matching record, oldest first. Return false to stop the query.
+typedef bool (*VisitLogVisitor)(const VisitLogRecord& record, void* context);
+
+class VisitLog {
+public:
+  // Scan the existing segments (two record reads each). Returns false without files.
+  bool begin(VisitLogFiles* files);
+
+  // Log time for a record written now: epochSeconds when the wall clock is set (non-zero),
+  // otherwise an estimate continuing from the last record. Never goes backwards.
+  uint32_t timeNow(unsigned long uptimeMs, uint32_t epochSeconds, uint8_t& flags) const;
+
+  // Buffer a record written at now (HalClock milliseconds); fills in record.check.
+  // Writes the batch first when the buffer is full. false = no files, or that write failed.
+  bool append(VisitLogRecord& record, unsigned long now);
+
+  bool flushDue(unsigned long now) const;
+  // Time until a flush is due with no further records (ULONG_MAX when nothing is buffered)
+  unsigned long msUntilFlush(unsigned long now) const;
+  bool flush(); // Write the buffered records. false = a write failed and its records are lost
+
+  // Records with from <= time < to, for one chicken (as visitor or new chicken of a change)
+  // or all of them with NO_CHICKEN. Flushes first. Returns the number of records passed to visitor.
+  uint32_t query(uint32_t from, uint32_t to, ChickenHandle chicken, VisitLogVisitor visitor, void* context);
+
+  bool enabled() const { return files != nullptr; }
+  uint32_t size() const; // Including buffered records
+  uint32_t lastTime() const { return latest; }
+
+private:
+  // Time range of one segment, kept in RAM as the sparse index
+  struct Segment {
+    uint32_t id;
+    uint32_t count;
+    uint32_t firstTime;
+    uint32_t lastTime;
+  };
+
+  bool readRecord(uint32_t segment, uint32_t index, VisitLogRecord& record);
+  uint32_t firstAtOrAfter(const Segment& segment, uint32_t time);
+  void openSegment();
+  bool write(const VisitLogRecord* records, uint32_t count);
+
+  VisitLogFiles* files = nullptr;
+  Segment segments[VISIT_LOG_MAX_SEGMENTS]; // Oldest first
+  int segmentCount = 0;
+  bool tailWritable = false; // false after a torn record: the next append starts a new segment
+  uint32_t bootBase = 0;     // Estimated time at boot
+  uint32_t latest = 0;
+  VisitLogRecord pending[VISIT_LOG_WRITE_BATCH]; // Appended, not written yet
+  uint32_t pendingCount = 0;
+  unsigned long pendingSince = 0;
+};
+
+#endif
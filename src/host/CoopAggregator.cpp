@@ -0,0 +1,349 @@
+#include "CoopAggregator.h"
+#include <JsonArena.h>
+#include <Crc32.h>
+#include <LogLevel.h>
+#include <ArduinoJson.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Incoming payloads are parsed and outgoing ones built here, one at a time, without the heap
+static JsonArena arena;
+static char payloadBuffer[COOP_PAYLOAD_MAX];
+static uint8_t registryBlob[REGISTRY_BLOB_MAX];
+
+#define NO_NEST 0xFF
+
+// Compact payloads (NestTracker.h) are MessagePack arrays, JSON ones objects
+static bool isMsgPack(const char* payload, size_t length) {
+  uint8_t first = length > 0 ? (uint8_t)payload[0] : 0;
+  return (first & 0xF0) == 0x90 || first == 0xDC;
+}
+
+void CoopAggregator::log(const char* format, ...) const {
+  char line[192];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  hal.log->println(line);
+}
+
+// The flock saved by the last registry update, else the built-in one
+void CoopAggregator::loadRegistry() {
+  size_t length = hal.storage ? hal.storage->load(REGISTRY_STORAGE_KEY, registryBlob, sizeof(registryBlob)) : 0;
+  if (length > 0 && chickenRegistry.deserialize(registryBlob, length)) {
+    LOGI("Chicken registry: %d chickens from storage", chickenRegistry.count());
+  } else {
+    loadDefaultChickens();
+    LOGI("Chicken registry: %d built-in chickens", chickenRegistry.count());
+  }
+}
+
+// Registry names first, else the name the nests last reported for that number
+void CoopAggregator::syncChickenStats() {
+  for (int i = 0; i < MAX_CHICKENS; i++) {
+    const Chicken* chicken = chickenByHandle((ChickenHandle)i);
+    chickenStats[i].name = chicken ? chicken->name : seenNames[i];
+  }
+}
+
+void CoopAggregator::begin(const Hal& halImpl) {
+  hal = halImpl;
+  loadRegistry();
+
+  for (int i = 0; i < MAX_CHICKENS; i++) {
+    chickenStats[i].visits = 0;
+    chickenStats[i].totalTime = 0;
+    chickenStats[i].lastVisit = 0;
+    seenNames[i][0] = '\0';
+    lastNest[i] = NO_NEST;
+  }
+  syncChickenStats();
+
+  statsStore.begin(hal.storage, COOP_STORAGE_SUFFIX);
+  if (statsStore.restore(chickenStats, MAX_CHICKENS)) {
+    LOGI("Restored coop stats from storage");
+  }
+  leaderboard.rebuild(chickenStats, MAX_CHICKENS);
+  lastMetrics = millis();
+}
+
+// Index of a nest by tag, added on first sight; -1 when the table is full
+int CoopAggregator::nestIndex(const char* tag, size_t length) {
+  if (length == 0 || length >= NEST_TAG_MAX) return -1;
+  for (int i = 0; i < nestCount; i++) {
+    if (strlen(nestTable[i].tag) == length && memcmp(nestTable[i].tag, tag, length) == 0) return i;
+  }
+  if (nestCount == COOP_MAX_NESTS) return -1;
+
+  Nest& nest = nestTable[nestCount];
+  memcpy(nest.tag, tag, length);
+  nest.tag[length] = '\0';
+  snprintf(nest.status, sizeof(nest.status), "unknown");
+  nest.occupantCount = 0;
+  nest.since = millis();
+  LOGI("Nest %s joined", nest.tag);
+  occupancyDirty = true;
+  return nestCount++;
+}
+
+void CoopAggregator::handleMessage(const char* topic, const char* payload, size_t length) {
+  count.messages++;
+
+  if (strcmp(topic, REGISTRY_TOPIC) == 0) {
+    applyRegistry(payload, length);
+    return;
+  }
+
+  // chickens/nest<tag>/visits | status
+  static const char prefix[] = "chickens/nest";
+  const char* tag = topic + sizeof(prefix) - 1;
+  const char* slash = strncmp(topic, prefix, sizeof(prefix) - 1) == 0 ? strchr(tag, '/') : nullptr;
+  int nest = slash ? nestIndex(tag, slash - tag) : -1;
+  if (nest < 0) {
+    count.ignored++;
+    return;
+  }
+
+  if (strcmp(slash, "/visits") == 0) {
+    handleVisit(nest, payload, length);
+  } else if (strcmp(slash, "/status") == 0) {
+    handleStatus(nest, payload, length);
+  } else {
+    count.ignored++;
+  }
+}
+
+void CoopAggregator::handleVisit(int nest, const char* payload, size_t length) {
+  JsonDocument doc(&arena);
+  bool compact = isMsgPack(payload, length);
+  if (compact ? deserializeMsgPack(doc, payload, length) : deserializeJson(doc, payload, length)) {
+    count.ignored++;
+    return;
+  }
+  // [number, duration, timestamp] or {"chicken_number", "chicken_name", "duration", ...}
+  int number = compact ? doc[0].as<int>() : doc["chicken_number"].as<int>();
+  const char* name = compact ? nullptr : doc["chicken_name"].as<const char*>();
+  unsigned long duration = compact ? doc[1].as<unsigned long>() : doc["duration"].as<unsigned long>();
+  if (number < 1 || number > MAX_CHICKENS) {
+    count.ignored++;
+    return;
+  }
+
+  ChickenHandle chicken = (ChickenHandle)(number - 1);
+  if (name && !chickenByHandle(chicken)) {
+    snprintf(seenNames[chicken], sizeof(seenNames[chicken]), "%s", name);
+  }
+
+  unsigned long now = millis();
+  chickenStats[chicken].visits++;
+  chickenStats[chicken].totalTime += duration;
+  chickenStats[chicken].lastVisit = now;
+  lastNest[chicken] = (uint8_t)nest;
+  leaderboard.update(chicken);
+  leaderboardDirty = true;
+  if (!statsDirty) dirtySince = now;
+  statsDirty = true;
+  count.visits++;
+}
+
+void CoopAggregator::handleStatus(int index, const char* payload, size_t length) {
+  JsonDocument doc(&arena);
+  bool compact = isMsgPack(payload, length);
+  if (compact ? deserializeMsgPack(doc, payload, length) : deserializeJson(doc, payload, length)) {
+    count.ignored++;
+    return;
+  }
+  const char* status = compact ? doc[0].as<const char*>() : doc["status"].as<const char*>();
+  if (!status) {
+    count.ignored++;
+    return;
+  }
+  count.statuses++;
+
+  // Occupants: the chickens array of a "multiple" status, else the single occupant
+  Nest next = nestTable[index];
+  snprintf(next.status, sizeof(next.status), "%s", status);
+  next.occupantCount = 0;
+  JsonArray chickens = doc["chickens"].as<JsonArray>();
+  if (compact) {
+    // [status, timestamp, duration, [numbers], [confidence]]: names from the registry or visits
+    for (JsonVariant chicken : doc[3].as<JsonArray>()) {
+      int number = chicken.as<int>();
+      if (number < 1 || number > MAX_CHICKENS || next.occupantCount == COOP_NEST_OCCUPANTS) continue;
+      snprintf(next.occupants[next.occupantCount++], CHICKEN_NAME_MAX, "%s", chickenStats[number - 1].name);
+    }
+  } else if (chickens.size() > 0) {
+    for (JsonVariant chicken : chickens) {
+      const char* name = chicken.as<const char*>();
+      if (!name || next.occupantCount == COOP_NEST_OCCUPANTS) continue;
+      snprintf(next.occupants[next.occupantCount++], CHICKEN_NAME_MAX, "%s", name);
+    }
+  } else if (strcmp(status, "empty") != 0) {
+    const char* occupant = doc["occupant"].as<const char*>();
+    if (occupant && occupant[0] != '\0') {
+      snprintf(next.occupants[next.occupantCount++], CHICKEN_NAME_MAX, "%s", occupant);
+    }
+  }
+
+  // Heartbeats repeat the same state: only a change moves "since" and needs a publish
+  Nest& nest = nestTable[index];
+  bool changed = strcmp(next.status, nest.status) != 0 || next.occupantCount != nest.occupantCount;
+  for (int i = 0; !changed && i < next.occupantCount; i++) {
+    changed = strcmp(next.occupants[i], nest.occupants[i]) != 0;
+  }
+  if (changed) {
+    next.since = millis();
+    nest = next;
+    occupancyDirty = true;
+  }
+}
+
+// A registry from the config topic: names and numbers for everything the nests report
+void CoopAggregator::applyRegistry(const char* text, size_t length) {
+  if (length == 0 || crc32(text, length) == chickenRegistry.source()) return; // Retained copy of the current one
+
+  int badLine = chickenRegistry.parse(text, length);
+  if (badLine != 0) {
+    LOGE("Chicken registry rejected: line %d invalid, keeping the current one", badLine);
+    loadRegistry();
+    count.ignored++;
+    return;
+  }
+  LOGI("Chicken registry updated: %d chickens", chickenRegistry.count());
+  size_t size = chickenRegistry.serialize(registryBlob, sizeof(registryBlob));
+  if (hal.storage && (size == 0 || !hal.storage->save(REGISTRY_STORAGE_KEY, registryBlob, size))) {
+    LOGE("Failed to save chicken registry");
+  }
+
+  // Stats are stored by tag: write them under the new tags right away
+  syncChickenStats();
+  leaderboard.rebuild(chickenStats, MAX_CHICKENS);
+  leaderboardDirty = true;
+  saveStats();
+}
+
+void CoopAggregator::saveStats() {
+  if (statsStore.flush(chickenStats, MAX_CHICKENS, millis())) {
+    statsDirty = false;
+  } else {
+    if (hal.storage) LOGE("Failed to save coop stats");
+    dirtySince = millis(); // Retry after another interval
+  }
+}
+
+void CoopAggregator::flush() {
+  if (statsDirty) saveStats();
+}
+
+void CoopAggregator::publishLeaderboard() {
+  JsonDocument doc(&arena);
+  JsonArray entries = doc["leaderboard"].to<JsonArray>();
+  uint32_t visits = 0;
+  for (int rank = 0; rank < LEADERBOARD_SIZE; rank++) {
+    ChickenHandle chicken = leaderboard.at(rank);
+    if (chicken == NO_CHICKEN || !leaderboard.ranked(chicken)) break;
+
+    const ChickenStats& stats = chickenStats[chicken];
+    JsonObject entry = entries.add<JsonObject>();
+    entry["rank"] = rank + 1;
+    entry["name"] = stats.name;
+    entry["number"] = chicken + 1;
+    entry["visits"] = stats.visits;
+    entry["total_time"] = stats.totalTime;
+    entry["avg_time"] = stats.visits > 0 ? stats.totalTime / stats.visits : 0;
+    if (lastNest[chicken] != NO_NEST) entry["last_nest"] = nestTable[lastNest[chicken]].tag;
+  }
+  for (int i = 0; i < MAX_CHICKENS; i++) visits += chickenStats[i].visits;
+  doc["visits"] = visits;
+  doc["nests"] = nestCount;
+  doc["updated"] = millis();
+
+  serializeJson(doc, payloadBuffer, sizeof(payloadBuffer));
+  if (hal.publisher->publish(COOP_TOPIC_LEADERBOARD, payloadBuffer)) {
+    leaderboard.markPublished();
+    leaderboardDirty = false;
+    count.published++;
+  }
+}
+
+void CoopAggregator::publishOccupancy() {
+  JsonDocument doc(&arena);
+  JsonObject nests = doc["nests"].to<JsonObject>();
+  JsonObject where = doc["where"].to<JsonObject>(); // Chicken name -> nest tag
+  int occupied = 0;
+  for (int i = 0; i < nestCount; i++) {
+    const Nest& nest = nestTable[i];
+    JsonObject entry = nests[nest.tag].to<JsonObject>();
+    entry["status"] = nest.status;
+    entry["since"] = nest.since;
+    JsonArray occupants = entry["occupants"].to<JsonArray>();
+    for (int o = 0; o < nest.occupantCount; o++) {
+      occupants.add(nest.occupants[o]);
+      where[nest.occupants[o]] = nest.tag;
+    }
+    if (nest.occupantCount > 0) occupied++;
+  }
+  doc["occupied"] = occupied;
+  doc["updated"] = millis();
+
+  serializeJson(doc, payloadBuffer, sizeof(payloadBuffer));
+  if (hal.publisher->publish(COOP_TOPIC_OCCUPANCY, payloadBuffer)) {
+    occupancyDirty = false;
+    count.published++;
+  }
+}
+
+void CoopAggregator::publishMetrics() {
+  JsonDocument doc(&arena);
+  doc["uptime"] = millis() / 1000;
+  doc["messages"] = count.messages;
+  doc["visits"] = count.visits;
+  doc["statuses"] = count.statuses;
+  doc["ignored"] = count.ignored;
+  doc["published"] = count.published;
+  doc["nests"] = nestCount;
+  doc["arena_peak"] = (uint32_t)arena.highWater();
+  JsonObject registry = doc["registry"].to<JsonObject>();
+  registry["chickens"] = chickenRegistry.count();
+  registry["crc"] = chickenRegistry.source();
+
+  serializeJson(doc, payloadBuffer, sizeof(payloadBuffer));
+  hal.publisher->publish(COOP_TOPIC_METRICS, payloadBuffer);
+  lastMetrics = millis();
+}
+
+void CoopAggregator::update() {
+  unsigned long now = millis();
+
+  if (hal.publisher->connected() && now - lastPublish >= COOP_PUBLISH_INTERVAL_MS &&
+      (leaderboardDirty || occupancyDirty)) {
+    if (leaderboardDirty) publishLeaderboard();
+    if (occupancyDirty) publishOccupancy();
+    lastPublish = now;
+  }
+  if (hal.publisher->connected() && now - lastMetrics >= COOP_METRICS_INTERVAL_MS) {
+    publishMetrics();
+  }
+  if (statsDirty && now - dirtySince >= COOP_SAVE_INTERVAL_MS) {
+    saveStats();
+  }
+}
+
+unsigned long CoopAggregator::idleMs() {
+  unsigned long now = millis();
+  unsigned long idle = COOP_MAX_IDLE_MS;
+  auto keepUntil = [&idle, now](unsigned long since, unsigned long interval) {
+    unsigned long elapsed = now - since;
+    unsigned long ms = elapsed >= interval ? 0 : interval - elapsed;
+    if (ms < idle) idle = ms;
+  };
+
+  if (hal.publisher->connected()) {
+    if (leaderboardDirty || occupancyDirty) keepUntil(lastPublish, COOP_PUBLISH_INTERVAL_MS);
+    keepUntil(lastMetrics, COOP_METRICS_INTERVAL_MS);
+  }
+  if (statsDirty) keepUntil(dirtySince, COOP_SAVE_INTERVAL_MS);
+  return idle;
+}
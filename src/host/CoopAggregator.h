@@ -0,0 +1,107 @@
+#ifndef COOP_AGGREGATOR_H
+#define COOP_AGGREGATOR_H
+
+#include <Hal.h>
+#include <ChickenDatabase.h>
+#include <ChickenStats.h>
+#include <StatsStore.h>
+#include <Leaderboard.h>
+#include <NestTracker.h>
+
+// Merges what every nest publishes into one per-chicken store for the whole coop:
+// visits from chickens/<nest>/visits add up per chicken (keyed by chicken number, so a hen's
+// laying time counts across boxes), chickens/<nest>/status feeds an occupancy map.
+// Consolidated messages are coalesced: at most one of each per COOP_PUBLISH_INTERVAL_MS,
+// however many events arrive in between.
+
+#define COOP_TOPIC_LEADERBOARD "chickens/coop/leaderboard" // Top ranks over all nests
+#define COOP_TOPIC_OCCUPANCY "chickens/coop/occupancy"     // Every nest's state, and where each chicken is
+#define COOP_TOPIC_METRICS "chickens/coop/system/metrics"
+#define COOP_MAX_NESTS 16
+#define COOP_NEST_OCCUPANTS 6            // Names kept per nest (a "multiple" status lists them all)
+#define COOP_PUBLISH_INTERVAL_MS 1000UL
+#define COOP_SAVE_INTERVAL_MS 10000UL    // Stats go to storage this long after the first unsaved visit
+#define COOP_METRICS_INTERVAL_MS 60000UL
+#define COOP_MAX_IDLE_MS 60000UL
+#define COOP_STORAGE_SUFFIX "_coop"      // Stats keys next to the nests' own in a shared state dir
+#define COOP_PAYLOAD_MAX 8192
+
+// Topic filters the connection code subscribes to
+#define COOP_SUBSCRIPTIONS { "chickens/+/visits", "chickens/+/status", REGISTRY_TOPIC }
+
+struct CoopCounters {
+  uint32_t messages;   // Everything passed to handleMessage()
+  uint32_t visits;     // Visits merged
+  uint32_t statuses;   // Nest status updates
+  uint32_t ignored;    // Unknown topics, bad payloads, numbers outside the registry range
+  uint32_t published;  // Consolidated messages sent
+};
+
+class CoopAggregator {
+public:
+  // Uses hal.clock, hal.publisher, hal.log and (optional) hal.storage.
+  // Loads the stored registry (else the built-in flock) and the stats saved by the last run.
+  void begin(const Hal& hal);
+
+  // One message from the broker; payload need not be terminated
+  void handleMessage(const char* topic, const char* payload, size_t length);
+
+  // Publish whatever is due and save stats when due. Never waits.
+  void update();
+
+  // Milliseconds until update() has work due (0 = now)
+  unsigned long idleMs();
+
+  // Send the consolidated leaderboard and occupancy on the next update() (after a (re)connect)
+  void requestPublish() { leaderboardDirty = occupancyDirty = true; lastPublish = millis() - COOP_PUBLISH_INTERVAL_MS; }
+
+  // Save unsaved stats now (shutdown)
+  void flush();
+
+  const CoopCounters& counters() const { return count; }
+  int nests() const { return nestCount; }
+
+private:
+  struct Nest {
+    char tag[NEST_TAG_MAX];
+    char status[12];       // empty | occupied | multiple
+    char occupants[COOP_NEST_OCCUPANTS][CHICKEN_NAME_MAX];
+    int occupantCount;
+    unsigned long since;   // When status or occupants last changed (aggregator time)
+  };
+
+  void log(const char* format, ...) const __attribute__((format(printf, 2, 3)));
+  unsigned long millis() const { return hal.clock->millis(); }
+
+  int nestIndex(const char* tag, size_t length);
+  void handleVisit(int nest, const char* payload, size_t length);
+  void handleStatus(int nest, const char* payload, size_t length);
+  void applyRegistry(const char* text, size_t length);
+  void loadRegistry();
+  void syncChickenStats();
+  void saveStats();
+  void publishLeaderboard();
+  void publishOccupancy();
+  void publishMetrics();
+
+  Hal hal = {};
+
+  ChickenStats chickenStats[MAX_CHICKENS]; // Indexed by chicken handle, all nests together
+  char seenNames[MAX_CHICKENS][CHICKEN_NAME_MAX]; // Names from visit payloads, for numbers not in the registry
+  uint8_t lastNest[MAX_CHICKENS];          // Index into nests[] of the chicken's last visit, 0xFF = none
+  StatsStore statsStore;
+  Leaderboard leaderboard;
+
+  Nest nestTable[COOP_MAX_NESTS];
+  int nestCount = 0;
+
+  bool leaderboardDirty = true;
+  bool occupancyDirty = true;
+  bool statsDirty = false;
+  unsigned long dirtySince = 0;
+  unsigned long lastPublish = 0;
+  unsigned long lastMetrics = 0;
+  CoopCounters count = {};
+};
+
+#endif
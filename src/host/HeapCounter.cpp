@@ -0,0 +1,64 @@
+#include "HeapCounter.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <atomic>
+
+static std::atomic<unsigned long> heapAllocations(0);
+
+#if defined(__GLIBC__)
+// Interpose the allocator entry points and forward to glibc's implementation
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+
+void* malloc(size_t size) noexcept {
+  heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+  heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) noexcept {
+  heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(pointer, size);
+}
+
+// Aligned allocations (aligned operator new goes through aligned_alloc or posix_memalign)
+void* memalign(size_t alignment, size_t size) noexcept {
+  heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+  heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, size_t alignment, size_t size) noexcept {
+  heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (alignment == 0 || alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+  void* memory = __libc_memalign(alignment, size);
+  if (!memory) return ENOMEM;
+  *pointer = memory;
+  return 0;
+}
+
+void free(void* pointer) noexcept {
+  __libc_free(pointer);
+}
+}
+
+bool heapCounterAvailable() { return true; }
+#else
+bool heapCounterAvailable() { return false; }
+#endif
+
+unsigned long heapAllocationCount() {
+  return heapAllocations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,12 @@
+#ifndef HEAP_COUNTER_H
+#define HEAP_COUNTER_H
+
+// Counts heap allocations made by the host program (malloc/calloc/realloc, memalign/
+// aligned_alloc/posix_memalign and everything built on them, operator new included).
+// valloc/pvalloc are not counted. Used to check that the publish path stays off the heap.
+// Only available with glibc; heapCounterAvailable() is false elsewhere and the count stays 0.
+
+bool heapCounterAvailable();
+unsigned long heapAllocationCount();
+
+#endif
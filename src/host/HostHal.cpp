@@ -0,0 +1,181 @@
+#include "HostHal.h"
+#include <dirent.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static unsigned long long monotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000ULL;
+}
+
+HostClock::HostClock() : startMs(monotonicMs()) {
+}
+
+unsigned long HostClock::millis() {
+  return (unsigned long)(monotonicMs() - startMs);
+}
+
+unsigned long HostClock::micros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)((unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL);
+}
+
+uint32_t HostClock::epochSeconds() {
+  return (uint32_t)time(nullptr);
+}
+
+void HostClock::delay(unsigned long ms) {
+  usleep((useconds_t)ms * 1000);
+}
+
+FdUart::FdUart(int fd) : fd(fd), atEof(false), pending(-1) {
+}
+
+int FdUart::available() {
+  if (pending >= 0) return 1;
+  if (atEof) return 0;
+
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  if (poll(&pfd, 1, 0) <= 0) return 0;
+
+  unsigned char byte;
+  ssize_t n = ::read(fd, &byte, 1);
+  if (n <= 0) {
+    atEof = true;
+    return 0;
+  }
+  pending = byte;
+  return 1;
+}
+
+int FdUart::read() {
+  if (!available()) return -1;
+  int byte = pending;
+  pending = -1;
+  return byte;
+}
+
+bool StdoutPublisher::publish(const char* topic, const char* payload) {
+  fprintf(out, "%s %s\n", topic, payload);
+  fflush(out);
+  return true;
+}
+
+bool StdoutPublisher::publish(const char* topic, const uint8_t* payload, size_t length) {
+  fprintf(out, "%s ", topic);
+  printBinaryPayload(out, payload, length);
+  fputc('\n', out);
+  fflush(out);
+  return true;
+}
+
+void printBinaryPayload(FILE* out, const uint8_t* payload, size_t length) {
+  fputs("0x", out);
+  for (size_t i = 0; i < length; i++) fprintf(out, "%02x", payload[i]);
+}
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+size_t decodeBinaryPayload(char* text, size_t length) {
+  if (length < 2 || length % 2 != 0 || text[0] != '0' || text[1] != 'x') return length;
+  for (size_t i = 2; i < length; i++) {
+    if (hexDigit(text[i]) < 0) return length;
+  }
+  size_t bytes = 0;
+  for (size_t i = 2; i < length; i += 2) {
+    text[bytes++] = (char)(hexDigit(text[i]) << 4 | hexDigit(text[i + 1]));
+  }
+  return bytes;
+}
+
+void StderrLog::println(const char* line) {
+  fprintf(stderr, "%s\n", line);
+}
+
+size_t FileStorage::load(const char* key, void* data, size_t size) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s.bin", dir, key);
+  FILE* file = fopen(path, "rb");
+  if (!file) return 0;
+  size_t length = fread(data, 1, size, file);
+  bool longer = fgetc(file) != EOF;
+  fclose(file);
+  return longer ? 0 : length;
+}
+
+// Write to a temporary file and rename, so a crash never leaves half a record
+bool FileStorage::save(const char* key, const void* data, size_t size) {
+  char path[256];
+  char tempPath[260];
+  snprintf(path, sizeof(path), "%s/%s.bin", dir, key);
+  snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+  FILE* file = fopen(tempPath, "wb");
+  if (!file) return false;
+  bool ok = fwrite(data, 1, size, file) == size;
+  ok = fclose(file) == 0 && ok;
+  return ok && rename(tempPath, path) == 0;
+}
+
+void DirVisitLogFiles::path(uint32_t segment, char* buffer, size_t size) {
+  snprintf(buffer, size, "%s/visits-%08x.seg", dir, (unsigned)segment);
+}
+
+bool DirVisitLogFiles::range(uint32_t& first, uint32_t& last) {
+  DIR* directory = opendir(dir);
+  if (!directory) return false;
+  bool found = false;
+  struct dirent* entry;
+  while ((entry = readdir(directory)) != nullptr) {
+    unsigned segment;
+    char suffix[8];
+    if (sscanf(entry->d_name, "visits-%8x.%7s", &segment, suffix) != 2 || strcmp(suffix, "seg") != 0) continue;
+    if (!found || segment < first) first = segment;
+    if (!found || segment > last) last = segment;
+    found = true;
+  }
+  closedir(directory);
+  return found;
+}
+
+uint32_t DirVisitLogFiles::size(uint32_t segment) {
+  char file[256];
+  path(segment, file, sizeof(file));
+  struct stat info;
+  return stat(file, &info) == 0 ? (uint32_t)info.st_size : 0;
+}
+
+size_t DirVisitLogFiles::read(uint32_t segment, uint32_t offset, void* data, size_t size) {
+  char file[256];
+  path(segment, file, sizeof(file));
+  FILE* in = fopen(file, "rb");
+  if (!in) return 0;
+  size_t length = fseek(in, offset, SEEK_SET) == 0 ? fread(data, 1, size, in) : 0;
+  fclose(in);
+  return length;
+}
+
+bool DirVisitLogFiles::append(uint32_t segment, const void* data, size_t size) {
+  char file[256];
+  path(segment, file, sizeof(file));
+  FILE* out = fopen(file, "ab");
+  if (!out) return false;
+  bool ok = fwrite(data, 1, size, out) == size;
+  return fclose(out) == 0 && ok;
+}
+
+bool DirVisitLogFiles::remove(uint32_t segment) {
+  char file[256];
+  path(segment, file, sizeof(file));
+  return ::remove(file) == 0;
+}
@@ -0,0 +1,85 @@
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <Hal.h>
+#include <VisitLog.h>
+#include <stdio.h>
+
+// Linux implementations of the tracking HAL for the native build
+
+class HostClock : public HalClock {
+public:
+  HostClock();
+  unsigned long millis() override;
+  void delay(unsigned long ms) override;
+  unsigned long micros() override;
+  uint32_t epochSeconds() override;
+private:
+  unsigned long long startMs;
+};
+
+// Reads raw EL125 bytes from a file descriptor (stdin by default) without blocking
+class FdUart : public HalUart {
+public:
+  explicit FdUart(int fd = 0);
+  int available() override;
+  int read() override;
+  bool eof() const { return atEof; }
+private:
+  int fd;
+  bool atEof;
+  int pending; // One byte of lookahead, -1 when empty
+};
+
+class HostResetPin : public HalResetPin {
+public:
+  void write(bool high) override { level = high; }
+  bool level = true;
+};
+
+// Binary payloads in the line-oriented tools: "0x" and two hex digits per byte
+void printBinaryPayload(FILE* out, const uint8_t* payload, size_t length);
+// Decode such a payload in place; returns the byte count, or length unchanged when text is not one
+size_t decodeBinaryPayload(char* text, size_t length);
+
+// Prints "topic payload" lines
+class StdoutPublisher : public HalPublisher {
+public:
+  explicit StdoutPublisher(FILE* out = stdout) : out(out) {}
+  bool connected() override { return true; }
+  bool publish(const char* topic, const char* payload) override;
+  bool publish(const char* topic, const uint8_t* payload, size_t length) override;
+private:
+  FILE* out;
+};
+
+class StderrLog : public HalLog {
+public:
+  void println(const char* line) override;
+};
+
+// One file per key in a directory ("<dir>/<key>.bin")
+class FileStorage : public HalStorage {
+public:
+  explicit FileStorage(const char* dir) : dir(dir) {}
+  size_t load(const char* key, void* data, size_t size) override;
+  bool save(const char* key, const void* data, size_t size) override;
+private:
+  const char* dir;
+};
+
+// Visit log segments as "<dir>/visits-<segment>.seg"
+class DirVisitLogFiles : public VisitLogFiles {
+public:
+  explicit DirVisitLogFiles(const char* dir) : dir(dir) {}
+  bool range(uint32_t& first, uint32_t& last) override;
+  uint32_t size(uint32_t segment) override;
+  size_t read(uint32_t segment, uint32_t offset, void* data, size_t size) override;
+  bool append(uint32_t segment, const void* data, size_t size) override;
+  bool remove(uint32_t segment) override;
+private:
+  void path(uint32_t segment, char* buffer, size_t size);
+  const char* dir;
+};
+
+#endif
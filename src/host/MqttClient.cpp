@@ -0,0 +1,290 @@
+#include "MqttClient.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Fixed header packet types
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_SUBSCRIBE 0x82 // Reserved flag bits 0010
+#define MQTT_SUBACK 0x90
+#define MQTT_PINGREQ 0xC0
+#define MQTT_PINGRESP 0xD0
+#define MQTT_DISCONNECT 0xE0
+
+MqttClient::MqttClient(const char* host, int port, const char* clientId, const char* user,
+                       const char* password)
+    : host(host), port(port), clientId(clientId), user(user), password(password) {}
+
+MqttClient::~MqttClient() {
+  disconnect();
+}
+
+unsigned long long MqttClient::nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Length-prefixed UTF-8 string
+size_t MqttClient::putString(uint8_t* out, const char* text, size_t length) {
+  out[0] = (uint8_t)(length >> 8);
+  out[1] = (uint8_t)length;
+  memcpy(out + 2, text, length);
+  return length + 2;
+}
+
+bool MqttClient::writeAll(const uint8_t* data, size_t length) {
+  while (length > 0) {
+    ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      disconnect();
+      return false;
+    }
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+bool MqttClient::sendPacket(uint8_t header, const uint8_t* body, size_t length) {
+  if (fd < 0) return false;
+
+  // Fixed header: type/flags, then the remaining length in 7-bit groups
+  uint8_t fixed[5];
+  size_t used = 0;
+  fixed[used++] = header;
+  size_t remaining = length;
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    fixed[used++] = remaining > 0 ? (digit | 0x80) : digit;
+  } while (remaining > 0);
+
+  if (!writeAll(fixed, used) || !writeAll(body, length)) return false;
+  lastSent = nowMs();
+  return true;
+}
+
+bool MqttClient::connect() {
+  disconnect();
+
+  char service[8];
+  snprintf(service, sizeof(service), "%d", port);
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addresses = nullptr;
+  if (getaddrinfo(host, service, &hints, &addresses) != 0) return false;
+
+  // Non-blocking connect, so an unreachable broker costs at most the timeout
+  for (struct addrinfo* address = addresses; address && fd < 0; address = address->ai_next) {
+    int s = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (s < 0) continue;
+    int flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, flags | O_NONBLOCK);
+    int rc = ::connect(s, address->ai_addr, address->ai_addrlen);
+    if (rc < 0 && errno == EINPROGRESS) {
+      struct pollfd pfd = { s, POLLOUT, 0 };
+      int error = 0;
+      socklen_t errorLength = sizeof(error);
+      if (poll(&pfd, 1, MQTT_CONNECT_TIMEOUT_MS) == 1 &&
+          getsockopt(s, SOL_SOCKET, SO_ERROR, &error, &errorLength) == 0 && error == 0) {
+        rc = 0;
+      }
+    }
+    if (rc == 0) {
+      fcntl(s, F_SETFL, flags); // Blocking writes from here on; reads go through poll()
+      struct timeval timeout = { MQTT_CONNECT_TIMEOUT_MS / 1000, 0 };
+      setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+      fd = s;
+    } else {
+      close(s);
+    }
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0) return false;
+
+  // CONNECT: protocol "MQTT" level 4, clean session, credentials when given
+  size_t length = putString(tx, "MQTT", 4);
+  tx[length++] = 4;
+  uint8_t flags = 0x02;
+  if (user) flags |= 0x80;
+  if (user && password) flags |= 0x40;
+  tx[length++] = flags;
+  tx[length++] = (uint8_t)(MQTT_KEEPALIVE_S >> 8);
+  tx[length++] = (uint8_t)MQTT_KEEPALIVE_S;
+  length += putString(tx + length, clientId, strlen(clientId));
+  if (user) length += putString(tx + length, user, strlen(user));
+  if (user && password) length += putString(tx + length, password, strlen(password));
+  rxUsed = 0;
+  awaitingPong = false;
+  if (!sendPacket(MQTT_CONNECT, tx, length)) return false;
+
+  // CONNACK: 0x20 0x02 <session present> <return code>
+  uint8_t connack[4];
+  size_t got = 0;
+  unsigned long long deadline = nowMs() + MQTT_CONNECT_TIMEOUT_MS;
+  while (got < sizeof(connack)) {
+    unsigned long long now = nowMs();
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (now >= deadline || poll(&pfd, 1, (int)(deadline - now)) != 1) break;
+    ssize_t n = recv(fd, connack + got, sizeof(connack) - got, 0);
+    if (n <= 0) break;
+    got += n;
+  }
+  if (got < sizeof(connack) || connack[0] != MQTT_CONNACK || connack[3] != 0) {
+    disconnect();
+    return false;
+  }
+  return true;
+}
+
+void MqttClient::disconnect() {
+  if (fd < 0) return;
+  static const uint8_t packet[2] = { MQTT_DISCONNECT, 0 };
+  send(fd, packet, sizeof(packet), MSG_NOSIGNAL | MSG_DONTWAIT);
+  close(fd);
+  fd = -1;
+}
+
+bool MqttClient::subscribe(const char* topicFilter) {
+  size_t topicLength = strlen(topicFilter);
+  if (topicLength + 5 > sizeof(tx)) return false;
+
+  size_t length = 0;
+  uint16_t id = nextPacketId++;
+  if (nextPacketId == 0) nextPacketId = 1;
+  tx[length++] = (uint8_t)(id >> 8);
+  tx[length++] = (uint8_t)id;
+  length += putString(tx + length, topicFilter, topicLength);
+  tx[length++] = 0; // QoS 0
+  return sendPacket(MQTT_SUBSCRIBE, tx, length);
+}
+
+bool MqttClient::publish(const char* topic, const char* payload, bool retain) {
+  return publish(topic, (const uint8_t*)payload, strlen(payload), retain);
+}
+
+bool MqttClient::publish(const char* topic, const uint8_t* payload, size_t payloadLength, bool retain) {
+  size_t topicLength = strlen(topic);
+  if (topicLength + 2 + payloadLength > sizeof(tx)) return false;
+
+  size_t length = putString(tx, topic, topicLength);
+  memcpy(tx + length, payload, payloadLength);
+  length += payloadLength;
+  if (!sendPacket(MQTT_PUBLISH | (retain ? 1 : 0), tx, length)) return false;
+  messagesOut++;
+  return true;
+}
+
+bool MqttClient::handlePacket(uint8_t header, const uint8_t* body, size_t length) {
+  switch (header & 0xF0) {
+    case MQTT_PUBLISH: {
+      if (length < 2) return false;
+      size_t topicLength = ((size_t)body[0] << 8) | body[1];
+      size_t offset = 2 + topicLength;
+      if ((header & 0x06) != 0) offset += 2; // Packet id (QoS > 0, not requested by subscribe())
+      if (offset > length || topicLength >= sizeof(topicBuffer)) return offset <= length;
+      memcpy(topicBuffer, body + 2, topicLength);
+      topicBuffer[topicLength] = '\0';
+      messagesIn++;
+      if (messageHandler) {
+        messageHandler(handlerContext, topicBuffer, (const char*)body + offset, length - offset);
+      }
+      return true;
+    }
+    case MQTT_PINGRESP:
+      awaitingPong = false;
+      return true;
+    default:
+      return true; // SUBACK and anything else needs no answer at QoS 0
+  }
+}
+
+// Dispatch every complete packet in the receive buffer, keep a partial one for later
+bool MqttClient::readPackets() {
+  ssize_t n = recv(fd, rx + rxUsed, sizeof(rx) - rxUsed, MSG_DONTWAIT);
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+    disconnect();
+    return false;
+  }
+  if (n > 0) rxUsed += n;
+
+  size_t pos = 0;
+  while (rxUsed - pos >= 2) {
+    size_t remaining = 0;
+    size_t headerLength = 1;
+    int shift = 0;
+    bool complete = false;
+    while (pos + headerLength < rxUsed && headerLength <= 4) {
+      uint8_t digit = rx[pos + headerLength++];
+      remaining |= (size_t)(digit & 0x7F) << shift;
+      shift += 7;
+      if (!(digit & 0x80)) {
+        complete = true;
+        break;
+      }
+    }
+    if (!complete) {
+      if (headerLength > 4) {
+        disconnect(); // Malformed length
+        return false;
+      }
+      break;
+    }
+    if (headerLength + remaining > sizeof(rx)) {
+      fprintf(stderr, "mqtt: %zu byte packet exceeds the receive buffer, disconnecting\n", remaining);
+      disconnect();
+      return false;
+    }
+    if (pos + headerLength + remaining > rxUsed) break;
+
+    if (!handlePacket(rx[pos], rx + pos + headerLength, remaining)) {
+      disconnect();
+      return false;
+    }
+    pos += headerLength + remaining;
+  }
+
+  memmove(rx, rx + pos, rxUsed - pos);
+  rxUsed -= pos;
+  return true;
+}
+
+bool MqttClient::loop(unsigned long timeoutMs) {
+  if (fd < 0) return false;
+
+  // Keepalive: ping at half the interval, give up when the answer is a full interval late
+  unsigned long long now = nowMs();
+  if (awaitingPong && now - pingSent > MQTT_KEEPALIVE_S * 1000ULL) {
+    disconnect();
+    return false;
+  }
+  if (!awaitingPong && now - lastSent >= MQTT_KEEPALIVE_S * 500ULL) {
+    static const uint8_t none = 0;
+    if (!sendPacket(MQTT_PINGREQ, &none, 0)) return false;
+    awaitingPong = true;
+    pingSent = now;
+  }
+
+  unsigned long untilPing = now - lastSent >= MQTT_KEEPALIVE_S * 500ULL ? 0 : MQTT_KEEPALIVE_S * 500ULL - (now - lastSent);
+  if (!awaitingPong && untilPing < timeoutMs) timeoutMs = untilPing;
+
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  int ready = poll(&pfd, 1, (int)timeoutMs);
+  if (ready < 0 && errno != EINTR) {
+    disconnect();
+    return false;
+  }
+  if (ready > 0) return readPackets();
+  return true;
+}
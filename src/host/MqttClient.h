@@ -0,0 +1,82 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <Hal.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal MQTT 3.1.1 client over a POSIX TCP socket for the host tools: QoS 0 only,
+// clean session, one blocking connect, non-blocking receive through loop().
+// Doubles as the HalPublisher of whatever runs on top of it.
+
+#define MQTT_DEFAULT_PORT 1883
+#define MQTT_KEEPALIVE_S 30
+#define MQTT_CONNECT_TIMEOUT_MS 5000
+#define MQTT_RX_BUFFER_SIZE 65536 // Largest incoming packet (the retained chicken registry)
+#define MQTT_TX_BUFFER_SIZE 16384 // Largest outgoing packet
+
+class MqttClient : public HalPublisher {
+public:
+  // Called from loop() for every PUBLISH received; payload is not terminated
+  typedef void (*MessageHandler)(void* context, const char* topic, const char* payload, size_t length);
+
+  MqttClient(const char* host, int port, const char* clientId, const char* user = nullptr,
+             const char* password = nullptr);
+  ~MqttClient();
+
+  void onMessage(MessageHandler handler, void* context) {
+    messageHandler = handler;
+    handlerContext = context;
+  }
+
+  // TCP connect plus CONNECT/CONNACK, waiting at most MQTT_CONNECT_TIMEOUT_MS
+  bool connect();
+  void disconnect();
+  bool connected() override { return fd >= 0; }
+
+  bool subscribe(const char* topicFilter);
+  bool publish(const char* topic, const char* payload) override { return publish(topic, payload, false); }
+  bool publish(const char* topic, const char* payload, bool retain);
+  bool publish(const char* topic, const uint8_t* payload, size_t length) override { return publish(topic, payload, length, false); }
+  bool publish(const char* topic, const uint8_t* payload, size_t length, bool retain);
+
+  // Wait up to timeoutMs for incoming packets and dispatch them; keeps the connection alive.
+  // false = the connection was lost (connected() is false from then on).
+  bool loop(unsigned long timeoutMs);
+
+  uint32_t received() const { return messagesIn; }
+  uint32_t sent() const { return messagesOut; }
+
+private:
+  bool sendPacket(uint8_t header, const uint8_t* body, size_t length);
+  bool writeAll(const uint8_t* data, size_t length);
+  bool readPackets();
+  bool handlePacket(uint8_t header, const uint8_t* body, size_t length);
+  static size_t putString(uint8_t* out, const char* text, size_t length);
+  static unsigned long long nowMs();
+
+  const char* host;
+  int port;
+  const char* clientId;
+  const char* user;
+  const char* password;
+
+  int fd = -1;
+  uint16_t nextPacketId = 1;
+  unsigned long long lastSent = 0;
+  bool awaitingPong = false;
+  unsigned long long pingSent = 0;
+
+  MessageHandler messageHandler = nullptr;
+  void* handlerContext = nullptr;
+
+  uint8_t rx[MQTT_RX_BUFFER_SIZE + 5]; // Fixed header (up to 5 bytes) + body
+  size_t rxUsed = 0;
+  uint8_t tx[MQTT_TX_BUFFER_SIZE];
+  char topicBuffer[256];
+
+  uint32_t messagesIn = 0;
+  uint32_t messagesOut = 0;
+};
+
+#endif
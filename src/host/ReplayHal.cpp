@@ -0,0 +1,91 @@
+#include "ReplayHal.h"
+#include "HostHal.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void appendTagFrame(std::vector<uint8_t>& bytes, unsigned long long tag) {
+  uint8_t frame[EL125_FRAME_LEN];
+  bytes.insert(bytes.end(), frame, frame + encodeEl125Frame(tag, frame));
+}
+
+bool TraceUart::load(FILE* in) {
+  char line[1024];
+  int lineNo = 0;
+  while (fgets(line, sizeof(line), in)) {
+    lineNo++;
+    char* p = line;
+    while (isspace((unsigned char)*p)) p++;
+    if (*p == '\0' || *p == '#') continue;
+
+    char* end;
+    TraceChunk chunk;
+    chunk.timeMs = strtoul(p, &end, 10);
+    if (end == p) {
+      fprintf(stderr, "trace:%d: missing timestamp\n", lineNo);
+      return false;
+    }
+    p = end;
+    while (isspace((unsigned char)*p)) p++;
+
+    if (strncmp(p, "tag", 3) == 0 && isspace((unsigned char)p[3])) {
+      appendTagFrame(chunk.bytes, strtoull(p + 3, &end, 16));
+    } else {
+      while (*p) {
+        unsigned long value = strtoul(p, &end, 16);
+        if (end == p) break;
+        chunk.bytes.push_back((uint8_t)value);
+        p = end;
+      }
+    }
+
+    if (!chunks.empty() && chunk.timeMs < chunks.back().timeMs) {
+      fprintf(stderr, "trace:%d: timestamps must not go backwards\n", lineNo);
+      return false;
+    }
+    chunks.push_back(chunk);
+  }
+  return true;
+}
+
+int TraceUart::available() {
+  size_t count = 0;
+  for (size_t i = chunkIndex; i < chunks.size() && chunks[i].timeMs <= clock.now; i++) {
+    count += chunks[i].bytes.size() - (i == chunkIndex ? byteIndex : 0);
+  }
+  return (int)count;
+}
+
+int TraceUart::read() {
+  while (chunkIndex < chunks.size() && chunks[chunkIndex].timeMs <= clock.now) {
+    const TraceChunk& chunk = chunks[chunkIndex];
+    if (byteIndex < chunk.bytes.size()) {
+      uint8_t byte = chunk.bytes[byteIndex++];
+      delivered++;
+      frameCounter.feed(byte);
+      if (byteIndex == chunk.bytes.size()) {
+        // Move on now so finished()/nextTimeMs() don't report a chunk that was read completely
+        chunkIndex++;
+        byteIndex = 0;
+      }
+      return byte;
+    }
+    chunkIndex++;
+    byteIndex = 0;
+  }
+  return -1;
+}
+
+bool CapturePublisher::publish(const char* topic, const char* payload) {
+  published++;
+  fprintf(out, "%lu %s %s\n", clock.now, topic, payload);
+  return true;
+}
+
+bool CapturePublisher::publish(const char* topic, const uint8_t* payload, size_t length) {
+  published++;
+  fprintf(out, "%lu %s ", clock.now, topic);
+  printBinaryPayload(out, payload, length);
+  fputc('\n', out);
+  return true;
+}
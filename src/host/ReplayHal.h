@@ -0,0 +1,73 @@
+#ifndef REPLAY_HAL_H
+#define REPLAY_HAL_H
+
+#include <Hal.h>
+#include <El125Parser.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <limits.h>
+#include <vector>
+
+// Virtual-time HAL used by the trace replay tool. Nothing here sleeps:
+// delay() just moves the virtual clock forward.
+
+class VirtualClock : public HalClock {
+public:
+  unsigned long millis() override { return now; }
+  void delay(unsigned long ms) override { now += ms; }
+  void advanceTo(unsigned long ms) { if (ms > now) now = ms; }
+  unsigned long now = 0;
+};
+
+struct TraceChunk {
+  unsigned long timeMs;
+  std::vector<uint8_t> bytes;
+};
+
+// Recorded EL125 byte stream. Text format, one chunk per line:
+//   <ms> <hex byte> <hex byte> ...   raw UART bytes as captured
+//   <ms> tag <hex tag id>            shorthand, expands to one EL125 frame (checksum included)
+// Blank lines and lines starting with '#' are ignored.
+class TraceUart : public HalUart {
+public:
+  explicit TraceUart(VirtualClock& clock) : clock(clock) {}
+
+  bool load(FILE* in);
+  int available() override;
+  int read() override;
+
+  bool finished() const { return chunkIndex >= chunks.size(); }
+  unsigned long lastTimeMs() const { return chunks.empty() ? 0 : chunks.back().timeMs; }
+  // Time of the next chunk not yet fully delivered, ULONG_MAX when finished
+  unsigned long nextTimeMs() const { return finished() ? ULONG_MAX : chunks[chunkIndex].timeMs; }
+  uint32_t bytesDelivered() const { return delivered; }
+  uint32_t framesDelivered() const { return frameCounter.framesAccepted(); }
+
+private:
+  VirtualClock& clock;
+  std::vector<TraceChunk> chunks;
+  size_t chunkIndex = 0;
+  size_t byteIndex = 0;
+  uint32_t delivered = 0;
+  El125Parser frameCounter; // Independent decoder, only used to count delivered frames
+};
+
+// Prints every publish as "<virtual ms> <topic> <payload>"
+class CapturePublisher : public HalPublisher {
+public:
+  CapturePublisher(VirtualClock& clock, FILE* out) : clock(clock), out(out) {}
+  bool connected() override { return true; }
+  bool publish(const char* topic, const char* payload) override;
+  bool publish(const char* topic, const uint8_t* payload, size_t length) override; // Hex, see HostHal.h
+  uint32_t published = 0;
+private:
+  VirtualClock& clock;
+  FILE* out;
+};
+
+class NullLog : public HalLog {
+public:
+  void println(const char*) override {}
+};
+
+#endif
@@ -0,0 +1,194 @@
+// Coop aggregator: merges what every nest publishes into one leaderboard and occupancy map.
+// Either connects to the broker the nests use, or reads "<ms> <topic> <payload>" lines
+// (the replay output format) as a stand-in for one and prints what it would publish.
+// Set CHICKEN_STATE_DIR to keep the coop stats and registry in that directory between runs.
+//
+//   pio run -e aggregator && .pio/build/aggregator/program [-v] -h broker [-p port] [-u user] [-P password]
+//   .pio/build/replay/program trace.txt | .pio/build/aggregator/program -i -
+
+#include "HostHal.h"
+#include "ReplayHal.h"
+#include "MqttClient.h"
+#include "CoopAggregator.h"
+#include <ConnectionManager.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INPUT_LINE_MAX (MQTT_RX_BUFFER_SIZE + 256) // "<ms> <topic> <payload>"
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+  stopRequested = 1;
+}
+
+static double wallSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char* argv0) {
+  fprintf(stderr, "usage: %s [-v] -h host [-p port] [-u user] [-P password]\n", argv0);
+  fprintf(stderr, "       %s [-v] -i <messages file | ->\n", argv0);
+  fprintf(stderr, "  -v         print aggregator debug output to stderr\n");
+  fprintf(stderr, "  -h host    MQTT broker the nests publish to\n");
+  fprintf(stderr, "  -p port    broker port (default %d)\n", MQTT_DEFAULT_PORT);
+  fprintf(stderr, "  -i file    read \"<ms> <topic> <payload>\" lines instead of a broker, print publishes\n");
+}
+
+// The host is always on the network: only the MQTT half of the link does anything
+class MqttNetworkLink : public NetworkLink {
+public:
+  explicit MqttNetworkLink(MqttClient& client) : client(client) {}
+  void wifiBegin() override {}
+  bool wifiConnected() override { return true; }
+  bool mqttConnect() override { return client.connect(); }
+  bool mqttConnected() override { return client.connected(); }
+private:
+  MqttClient& client;
+};
+
+static void onMessage(void* context, const char* topic, const char* payload, size_t length) {
+  static_cast<CoopAggregator*>(context)->handleMessage(topic, payload, length);
+}
+
+// Broker stand-in: every line is delivered at its timestamp, publishes go to stdout
+static int runInput(const char* path, CoopAggregator& aggregator, HalLog& log, HalStorage* storage) {
+  FILE* in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+
+  VirtualClock clock;
+  CapturePublisher publisher(clock, stdout);
+  Hal hal = { &clock, nullptr, nullptr, &publisher, &log, storage, nullptr };
+  aggregator.begin(hal);
+
+  static char line[INPUT_LINE_MAX];
+  uint32_t lines = 0;
+  double start = wallSeconds();
+  while (!stopRequested && fgets(line, sizeof(line), in)) {
+    char* topic;
+    unsigned long timeMs = strtoul(line, &topic, 10);
+    if (topic == line || *topic != ' ') continue;
+    topic++;
+    char* payload = strchr(topic, ' ');
+    if (!payload) continue;
+    *payload++ = '\0';
+    size_t length = decodeBinaryPayload(payload, strcspn(payload, "\r\n"));
+
+    // Publish whatever fell due before this message arrived
+    while (clock.now < timeMs) {
+      unsigned long idle = aggregator.idleMs();
+      clock.advanceTo(timeMs - clock.now < idle ? timeMs : clock.now + idle);
+      aggregator.update();
+    }
+    aggregator.handleMessage(topic, payload, length);
+    lines++;
+  }
+  if (in != stdin) fclose(in);
+
+  clock.delay(COOP_SAVE_INTERVAL_MS); // Let the last coalesced publishes go out
+  aggregator.update();
+  aggregator.flush();
+
+  double wall = wallSeconds() - start;
+  if (wall <= 0) wall = 1e-9;
+  fflush(stdout);
+  const CoopCounters& counters = aggregator.counters();
+  fprintf(stderr, "aggregator: %u messages in %.3f s wall (%.0f messages/s), %d nests\n",
+          (unsigned)lines, wall, lines / wall, aggregator.nests());
+  fprintf(stderr, "aggregator: %u visits, %u statuses, %u ignored, %u publishes\n",
+          (unsigned)counters.visits, (unsigned)counters.statuses, (unsigned)counters.ignored,
+          (unsigned)counters.published);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  const char* host = nullptr;
+  int port = MQTT_DEFAULT_PORT;
+  const char* user = nullptr;
+  const char* password = nullptr;
+  const char* inputFile = nullptr;
+  bool verbose = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "vh:p:u:P:i:")) != -1) {
+    switch (opt) {
+      case 'v': verbose = true; break;
+      case 'h': host = optarg; break;
+      case 'p': port = atoi(optarg); break;
+      case 'u': user = optarg; break;
+      case 'P': password = optarg; break;
+      case 'i': inputFile = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc || (host == nullptr) == (inputFile == nullptr)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  signal(SIGINT, requestStop);
+  signal(SIGTERM, requestStop);
+
+  StderrLog stderrLog;
+  NullLog nullLog;
+  HalLog& log = verbose ? (HalLog&)stderrLog : (HalLog&)nullLog;
+  const char* stateDir = getenv("CHICKEN_STATE_DIR");
+  FileStorage storage(stateDir ? stateDir : ".");
+
+  static CoopAggregator aggregator; // Large: keep it off the stack
+  if (inputFile) return runInput(inputFile, aggregator, log, stateDir ? &storage : nullptr);
+
+  char clientId[32];
+  snprintf(clientId, sizeof(clientId), "ChickenCoop-%d", (int)getpid());
+  static MqttClient client(host, port, clientId, user, password);
+  client.onMessage(onMessage, &aggregator);
+  MqttNetworkLink link(client);
+  HostClock clock;
+  ConnectionManager connection(link, (uint32_t)time(nullptr) ^ (uint32_t)getpid());
+
+  Hal hal = { &clock, nullptr, nullptr, &client, &log, stateDir ? &storage : nullptr, nullptr };
+  aggregator.begin(hal);
+
+  static const char* const subscriptions[] = COOP_SUBSCRIPTIONS;
+  while (!stopRequested) {
+    unsigned long now = clock.millis();
+    switch (connection.update(now)) {
+      case ConnectionManager::CONNECTED_EVENT:
+        fprintf(stderr, "aggregator: connected to %s:%d (reconnects: %u)\n", host, port,
+                (unsigned)connection.reconnectCount());
+        for (const char* filter : subscriptions) client.subscribe(filter);
+        aggregator.requestPublish();
+        break;
+      case ConnectionManager::DISCONNECTED:
+        fprintf(stderr, "aggregator: connection lost, reconnecting\n");
+        break;
+      case ConnectionManager::ATTEMPT_FAILED:
+        fprintf(stderr, "aggregator: connection attempt %u failed, retry in %lu ms\n",
+                (unsigned)connection.consecutiveFailures(), connection.retryAt() - now);
+        break;
+      default:
+        break;
+    }
+
+    aggregator.update();
+    unsigned long idle = aggregator.idleMs();
+    if (connection.connected()) {
+      client.loop(idle); // Returns early as soon as messages arrive
+    } else {
+      unsigned long wait = connection.msUntilUpdate(clock.millis());
+      clock.delay(wait < idle ? wait : idle);
+    }
+  }
+
+  aggregator.flush();
+  client.disconnect();
+  return 0;
+}
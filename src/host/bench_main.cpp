@@ -0,0 +1,247 @@
+// Microbenchmarks for the tracking hot paths, under a virtual clock with heap allocation counts.
+// One JSON object per line on stdout, so results can be diffed and checked between builds:
+//   {"bench":"el125_frame","iterations":200000,"runs":5,"ns_per_op":48.1,"ns_per_op_min":47.5,"allocs_per_op":0.000,"publish_bytes_per_op":0.0}
+//
+//   pio run -e bench && .pio/build/bench/program [-n iterations] [-r runs] [filter]
+
+#include "HostHal.h"
+#include "ReplayHal.h"
+#include "HeapCounter.h"
+#include <NestTracker.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_CHICKENS 15    // Size of the default flock
+#define BENCH_RUNS_MAX 32
+
+// Frames from memory, refilled before each tick
+class BufferUart : public HalUart {
+public:
+  void load(const uint8_t* bytes, size_t length) {
+    data = bytes;
+    size = length;
+    pos = 0;
+  }
+  int available() override { return (int)(size - pos); }
+  int read() override { return pos < size ? data[pos++] : -1; }
+private:
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  size_t pos = 0;
+};
+
+// Connected publisher that only counts what would go on the wire
+class CountingPublisher : public HalPublisher {
+public:
+  bool connected() override { return true; }
+  bool publish(const char*, const char* payload) override {
+    bytes += strlen(payload);
+    return true;
+  }
+  bool publish(const char*, const uint8_t*, size_t length) override {
+    bytes += length;
+    return true;
+  }
+  unsigned long long bytes = 0;
+};
+
+static VirtualClock virtualClock;
+static HostResetPin resetPin;
+static CountingPublisher publisher;
+static NullLog nullLog;
+static BufferUart uart;
+static NestTracker tracker;       // Scored flock, status and leaderboard benchmarks
+static NestTracker loopTracker;   // Owns the UART for the tick() benchmark
+
+static TagId tags[BENCH_CHICKENS];
+static uint8_t frames[BENCH_CHICKENS][EL125_FRAME_LEN];
+static TagId unknownTag;
+static volatile unsigned long long sink; // Keeps results of pure functions alive
+
+// One visit: the tag is read every 2 s for stayMs, then the tracker runs until the exit is seen
+static void visit(TagId tag, unsigned long stayMs) {
+  tracker.handleTag(tag, virtualClock.now);
+  uint32_t exits = tracker.trackingMetrics().exits;
+  unsigned long until = virtualClock.now + stayMs;
+  unsigned long deadline = virtualClock.now + 600000;
+  while (tracker.trackingMetrics().exits == exits && virtualClock.now < deadline) {
+    virtualClock.delay(100);
+    tracker.update();
+    loopTracker.update();
+    if (virtualClock.now < until && virtualClock.now % 2000 == 0) tracker.handleTag(tag, virtualClock.now);
+  }
+}
+
+// ---- Benchmarks: each runs its operation n times ----
+
+static void benchEl125Frame(unsigned long n) {
+  static El125Parser parser;
+  for (unsigned long i = 0; i < n; i++) {
+    const uint8_t* frame = frames[i % BENCH_CHICKENS];
+    for (size_t b = 0; b < sizeof(frames[0]); b++) {
+      if (parser.feed(frame[b]) == El125Parser::FRAME) sink += parser.tag();
+    }
+  }
+}
+
+static void benchFormatTag(unsigned long n) {
+  char text[TAG_TEXT_LEN];
+  for (unsigned long i = 0; i < n; i++) {
+    formatTagID(tags[i % BENCH_CHICKENS], text, sizeof(text));
+    sink += (unsigned char)text[0];
+  }
+}
+
+static void benchFindHit(unsigned long n) {
+  for (unsigned long i = 0; i < n; i++) {
+    sink += (uintptr_t)findChickenByTag(tags[i % BENCH_CHICKENS]);
+  }
+}
+
+static void benchFindMiss(unsigned long n) {
+  for (unsigned long i = 0; i < n; i++) {
+    sink += (uintptr_t)findChickenByTag(unknownTag + (i & 0xFF));
+  }
+}
+
+// Full leaderboard snapshot: ranking walk, JSON build and serialization
+static void benchLeaderboard(unsigned long n) {
+  for (unsigned long i = 0; i < n; i++) {
+    tracker.requestLeaderboard();
+    tracker.update();
+  }
+}
+
+// Forced status: JSON build, serialization and the status/occupant/occupants publishes
+static void benchStatus(unsigned long n) {
+  for (unsigned long i = 0; i < n; i++) {
+    tracker.publishStatus();
+    tracker.update();
+  }
+}
+
+static void setupStatus1() {
+  tracker.handleTag(tags[0], virtualClock.now);
+  tracker.update();
+}
+
+static void setupStatusMulti() {
+  for (int i = 0; i < OCCUPANCY_SLOTS; i++) {
+    tracker.handleTag(tags[i], virtualClock.now);
+  }
+  tracker.update();
+}
+
+// One tracker pass fed one frame: UART bytes, parser, validation, occupancy, publishing
+static void benchTickFrame(unsigned long n) {
+  for (unsigned long i = 0; i < n; i++) {
+    uart.load(frames[0], sizeof(frames[0]));
+    loopTracker.tick();
+  }
+}
+
+struct Bench {
+  const char* name;
+  void (*setup)();
+  void (*run)(unsigned long n);
+  unsigned long scale; // Iterations relative to -n (slow operations run fewer)
+};
+
+static const Bench benches[] = {
+  { "el125_frame", nullptr, benchEl125Frame, 1 },
+  { "format_tag_id", nullptr, benchFormatTag, 1 },
+  { "find_chicken_hit", nullptr, benchFindHit, 1 },
+  { "find_chicken_miss", nullptr, benchFindMiss, 1 },
+  { "leaderboard_snapshot", nullptr, benchLeaderboard, 20 },
+  { "nest_status_1", setupStatus1, benchStatus, 20 },
+  { "nest_status_multi", setupStatusMulti, benchStatus, 20 },
+  { "tick_frame", nullptr, benchTickFrame, 5 },
+};
+
+static double nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage(const char* argv0) {
+  fprintf(stderr, "usage: %s [-n iterations] [-r runs] [filter]\n", argv0);
+  fprintf(stderr, "  -n iterations  operations per run for the fast benchmarks (default 200000)\n");
+  fprintf(stderr, "  -r runs        timed runs per benchmark, median and minimum reported (default 5)\n");
+  fprintf(stderr, "  filter         only benchmarks whose name contains this text\n");
+}
+
+int main(int argc, char** argv) {
+  unsigned long iterations = 200000;
+  int runs = 5;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+    switch (opt) {
+      case 'n': iterations = strtoul(optarg, NULL, 10); break;
+      case 'r': runs = atoi(optarg); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind < argc - 1 || iterations == 0 || runs < 1 || runs > BENCH_RUNS_MAX) {
+    usage(argv[0]);
+    return 2;
+  }
+  const char* filter = optind < argc ? argv[optind] : "";
+
+  // The built-in flock, read as real frames (with their checksum) where a frame is needed
+  Hal hal = { &virtualClock, nullptr, &resetPin, &publisher, &nullLog, nullptr, nullptr };
+  tracker.begin(hal, "A");
+  Hal loopHal = { &virtualClock, &uart, &resetPin, &publisher, &nullLog, nullptr, nullptr };
+  loopTracker.begin(loopHal, "B");
+  for (int i = 0; i < BENCH_CHICKENS; i++) {
+    const Chicken* chicken = chickenByHandle((ChickenHandle)i);
+    if (!chicken) {
+      fprintf(stderr, "bench: the built-in flock has fewer than %d chickens\n", BENCH_CHICKENS);
+      return 1;
+    }
+    tags[i] = chicken->tagID;
+    encodeEl125Frame(tags[i], frames[i]);
+  }
+  unknownTag = 0x0400000000ULL;
+
+  // Scores for the leaderboard: chicken i visits BENCH_CHICKENS - i times
+  for (int i = 0; i < BENCH_CHICKENS; i++) {
+    for (int v = 0; v < BENCH_CHICKENS - i; v++) {
+      visit(tags[i], 20000);
+    }
+  }
+
+  for (const Bench& bench : benches) {
+    if (!strstr(bench.name, filter)) continue;
+    if (bench.setup) bench.setup();
+
+    unsigned long n = iterations / bench.scale;
+    if (n == 0) n = 1;
+    bench.run(n / 10 + 1); // Warm caches and the JSON arena
+
+    double perOp[BENCH_RUNS_MAX];
+    unsigned long heapBefore = heapAllocationCount();
+    unsigned long long bytesBefore = publisher.bytes;
+    for (int r = 0; r < runs; r++) {
+      double start = nowNs();
+      bench.run(n);
+      perOp[r] = (nowNs() - start) / n;
+    }
+    double ops = (double)n * runs;
+    double allocs = (heapAllocationCount() - heapBefore) / ops;
+    double bytes = (publisher.bytes - bytesBefore) / ops;
+
+    std::sort(perOp, perOp + runs);
+    printf("{\"bench\":\"%s\",\"iterations\":%lu,\"runs\":%d,\"ns_per_op\":%.1f,\"ns_per_op_min\":%.1f,"
+           "\"allocs_per_op\":%.3f,\"publish_bytes_per_op\":%.1f}\n",
+           bench.name, n, runs, perOp[runs / 2], perOp[0], allocs, bytes);
+    fflush(stdout);
+  }
+
+  if (!heapCounterAvailable()) fprintf(stderr, "bench: heap counter not available, allocs_per_op is 0\n");
+  return 0;
+}
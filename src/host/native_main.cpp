@@ -0,0 +1,37 @@
+// Native (Linux) entry point: runs the same tracking code as the ESP32 firmware.
+// Raw EL125 bytes are read from stdin, MQTT publishes are printed to stdout, debug to stderr.
+// Set CHICKEN_STATE_DIR to keep the chicken stats and visit log in that directory between runs.
+//
+//   pio run -e native && cat capture.bin | .pio/build/native/program
+
+#include "HostHal.h"
+#include <NestTracker.h>
+#include <stdlib.h>
+
+#ifndef NEST_TAG
+#define NEST_TAG "A"
+#endif
+
+int main() {
+  HostClock clock;
+  FdUart uart(0);
+  HostResetPin resetPin;
+  StdoutPublisher publisher;
+  StderrLog log;
+
+  const char* stateDir = getenv("CHICKEN_STATE_DIR");
+  FileStorage storage(stateDir ? stateDir : ".");
+  DirVisitLogFiles visitLogFiles(stateDir ? stateDir : ".");
+
+  Hal hal = { &clock, &uart, &resetPin, &publisher, &log, stateDir ? &storage : nullptr, nullptr };
+  static NestTracker tracker; // Large: keep it off the stack
+  tracker.begin(hal, NEST_TAG, nullptr, stateDir ? &visitLogFiles : nullptr);
+  tracker.publishNestStatus("empty");
+
+  // Same cadence as the firmware loop(); keep running after EOF so exits are still detected
+  while (true) {
+    tracker.tick();
+    clock.delay(100);
+  }
+  return 0;
+}
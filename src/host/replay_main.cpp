@@ -0,0 +1,176 @@
+// Trace replay: runs recorded EL125 traffic through the tracking logic under a virtual clock.
+// Publishes are written to stdout as "<virtual ms> <topic> <payload>", throughput to stderr.
+//
+//   pio run -e replay && .pio/build/replay/program [-v] [-H] [-a] [-p fixed|adaptive] [-c topics] [-r registry.txt] [-t tickMs] [-T tailMs] trace.txt
+
+#include "HostHal.h"
+#include "ReplayHal.h"
+#include "HeapCounter.h"
+#include <NestTracker.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NEST_TAG
+#define NEST_TAG "A"
+#endif
+
+static double wallSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// "visits,changes,status": send those topics in the compact form
+static bool setCompactTopics(char* list) {
+  for (char* name = strtok(list, ","); name; name = strtok(nullptr, ",")) {
+    if (strcmp(name, "visits") == 0) {
+      NestTracker::setPayloadFormat(NestTracker::VISITS, NestTracker::MSGPACK);
+    } else if (strcmp(name, "changes") == 0) {
+      NestTracker::setPayloadFormat(NestTracker::CHANGES, NestTracker::MSGPACK);
+    } else if (strcmp(name, "status") == 0) {
+      NestTracker::setPayloadFormat(NestTracker::STATUS, NestTracker::MSGPACK);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void usage(const char* argv0) {
+  fprintf(stderr, "usage: %s [-v] [-H] [-a] [-p fixed|adaptive] [-c topics] [-r registry] [-t tickMs] [-T tailMs] <trace file | ->\n", argv0);
+  fprintf(stderr, "  -v         print tracking debug output to stderr\n");
+  fprintf(stderr, "  -H         fail if the replay allocates from the heap after startup\n");
+  fprintf(stderr, "  -a         adaptive: sleep until idleMs() or the next trace line, like the firmware\n");
+  fprintf(stderr, "  -p policy  presence probe policy (default adaptive)\n");
+  fprintf(stderr, "  -c topics  comma-separated visits,changes,status: publish those as MessagePack (hex on stdout)\n");
+  fprintf(stderr, "  -r file    chicken registry in text form, as sent on %s (default built-in)\n", REGISTRY_TOPIC);
+  fprintf(stderr, "  -t tickMs  virtual time per loop() pass (default 100)\n");
+  fprintf(stderr, "  -T tailMs  keep running after the last trace line (default 60000)\n");
+}
+
+int main(int argc, char** argv) {
+  unsigned long tickMs = 100;
+  unsigned long tailMs = 60000;
+  bool verbose = false;
+  bool heapCheck = false;
+  bool adaptive = false;
+  PresencePolicy::Mode policy = PresencePolicy::ADAPTIVE;
+  const char* registryFile = nullptr;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "vHap:c:r:t:T:")) != -1) {
+    switch (opt) {
+      case 'v': verbose = true; break;
+      case 'H': heapCheck = true; break;
+      case 'a': adaptive = true; break;
+      case 'p':
+        if (strcmp(optarg, "fixed") == 0) {
+          policy = PresencePolicy::FIXED;
+        } else if (strcmp(optarg, "adaptive") == 0) {
+          policy = PresencePolicy::ADAPTIVE;
+        } else {
+          usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'c':
+        if (!setCompactTopics(optarg)) {
+          usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'r': registryFile = optarg; break;
+      case 't': tickMs = strtoul(optarg, NULL, 10); break;
+      case 'T': tailMs = strtoul(optarg, NULL, 10); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1 || tickMs == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  VirtualClock clock;
+  TraceUart uart(clock);
+
+  FILE* in = strcmp(argv[optind], "-") == 0 ? stdin : fopen(argv[optind], "r");
+  if (!in) {
+    perror(argv[optind]);
+    return 1;
+  }
+  bool loaded = uart.load(in);
+  if (in != stdin) fclose(in);
+  if (!loaded) return 1;
+
+  HostResetPin resetPin;
+  CapturePublisher publisher(clock, stdout);
+  StderrLog stderrLog;
+  NullLog nullLog;
+
+  Hal hal = { &clock, &uart, &resetPin, &publisher, verbose ? (HalLog*)&stderrLog : (HalLog*)&nullLog, nullptr, nullptr };
+  static NestTracker tracker; // Large: keep it off the stack
+  tracker.begin(hal, NEST_TAG);
+  NestTracker::setPresencePolicy(policy);
+  if (registryFile) {
+    // Applied by the first tracking pass, like a registry arriving right after boot
+    static char registry[REGISTRY_TEXT_MAX];
+    FILE* file = fopen(registryFile, "r");
+    size_t length = file ? fread(registry, 1, sizeof(registry), file) : 0;
+    if (file) fclose(file);
+    if (!NestTracker::updateRegistry(registry, length)) {
+      fprintf(stderr, "%s: missing, empty or longer than %d bytes\n", registryFile, REGISTRY_TEXT_MAX);
+      return 1;
+    }
+  }
+  tracker.publishNestStatus("empty");
+  tracker.update(); // Sends it: nest state goes out at the end of a tracking pass
+
+  // Startup is done (stdio buffers exist): from here on publishing must not allocate
+  unsigned long heapAtStart = heapAllocationCount();
+
+  unsigned long endMs = uart.lastTimeMs() + tailMs;
+  double start = wallSeconds();
+  unsigned long ticks = 0;
+
+  while (clock.now <= endMs) {
+    tracker.tick();
+    ticks++;
+    if (!adaptive) {
+      clock.delay(tickMs);
+    } else if (uart.available() == 0) {
+      // Sleep until the tracker has work due or the next bytes "arrive" (frames wake the firmware)
+      unsigned long idle = tracker.idleMs();
+      unsigned long next = uart.nextTimeMs();
+      if (next > clock.now && next - clock.now < idle) idle = next - clock.now;
+      clock.delay(idle > 0 ? idle : 1);
+    }
+  }
+
+  double wall = wallSeconds() - start;
+  unsigned long heapAllocations = heapAllocationCount() - heapAtStart;
+  if (wall <= 0) wall = 1e-9;
+  fflush(stdout);
+  fprintf(stderr, "replay: %.1f s virtual in %.3f s wall (%.0fx), %lu ticks\n",
+          clock.now / 1000.0, wall, clock.now / 1000.0 / wall, ticks);
+  fprintf(stderr, "replay: %u bytes, %u frames (%.0f frames/s), %u publishes (%.0f events/s)\n",
+          uart.bytesDelivered(), uart.framesDelivered(), uart.framesDelivered() / wall,
+          publisher.published, publisher.published / wall);
+  const TrackingMetrics& metrics = tracker.trackingMetrics();
+  fprintf(stderr, "replay: %s probing, %u exits, exit latency avg %u s max %u s, %u reader resets\n",
+          policy == PresencePolicy::FIXED ? "fixed" : "adaptive", (unsigned)metrics.exits,
+          metrics.exits ? (unsigned)(metrics.exitLatencyTotalS / metrics.exits) : 0u,
+          (unsigned)metrics.exitLatencyMaxS, (unsigned)metrics.resets);
+  if (heapCounterAvailable()) {
+    fprintf(stderr, "replay: %lu heap allocations after startup\n", heapAllocations);
+  } else if (heapCheck) {
+    fprintf(stderr, "replay: -H needs glibc to count heap allocations\n");
+    return 2;
+  }
+  if (heapCheck && heapAllocations > 0) {
+    fprintf(stderr, "replay: FAIL, the tracking/publish path allocated from the heap\n");
+    return 3;
+  }
+  return 0;
+}
@@ -1,11 +1,29 @@
 #include <Arduino.h>
 #include <WiFi.h>
+#include <Preferences.h>
+#include <LittleFS.h>
+#include <time.h>
 #include <PubSubClient.h>
-#include <ArduinoJson.h>
 #include "secrets.h"
+#include <Hal.h>
+#include <NestTracker.h>
+#include <El125Parser.h>
+#include <SpscRing.h>
+#include <PublishQueue.h>
+#include <LogQueue.h>
+#include <ConnectionManager.h>
 
 // Optional: for ESP32 unique ID helpers
 #include <esp_system.h>
+#include <driver/uart.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include <esp_vfs_eventfd.h>
+#include <sys/select.h>
+#include <unistd.h>
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
 
 // WiFi Configuration - From secrets.h
 const char* ssid = Secrets::WIFI_SSID;
@@ -17,935 +35,798 @@ const int mqtt_port = 1883;
 const char* mqtt_user = Secrets::MQTT_USER;
 const char* mqtt_password = Secrets::MQTT_PASSWORD;
 
-// NEST_TAG identifies this device (e.g. "A", "B", "C" or "1", "2", "3")
+#ifndef NTP_SERVER
+#define NTP_SERVER "pool.ntp.org"
+#endif
+
+// NEST_TAG identifies the (first) nest on this device (e.g. "A", "B", "C" or "1", "2", "3")
 // You can set this via PlatformIO build_flags: -DNEST_TAG=\"A\"
 #ifndef NEST_TAG
 #define NEST_TAG "A"
 #endif
 
-// Build a unique client ID per device using NEST_TAG + MAC (no colons)
-static char mqtt_client_id[64];
-static void buildClientId() {
-  String mac = WiFi.macAddress(); // format: XX:XX:XX:XX:XX:XX
-  mac.replace(":", "");
-  snprintf(mqtt_client_id, sizeof(mqtt_client_id), "chicken_%s_%s", NEST_TAG, mac.c_str());
-}
-
-// MQTT Topics (per nest tag). Example when NEST_TAG=="A": chickens/nestA/status
-static char topic_nest_status[64];
-static char topic_nest_occupant[64];
-static char topic_nest_occupants[64];  // NEW: Simple comma-separated format
-static char topic_nest_duration[64];
-static char topic_chicken_visits[64];
-static char topic_chicken_leaderboard[64];
-static char topic_chicken_changes[64];
-static char topic_system_status[64]; // per-device system heartbeat
-
-static void initTopics() {
-  // Compose like: chickens/nest<NEST_TAG>/...
-  snprintf(topic_nest_status, sizeof(topic_nest_status), "chickens/nest%s/status", NEST_TAG);
-  snprintf(topic_nest_occupant, sizeof(topic_nest_occupant), "chickens/nest%s/occupant", NEST_TAG);
-  snprintf(topic_nest_occupants, sizeof(topic_nest_occupants), "chickens/nest%s/occupants", NEST_TAG);
-  snprintf(topic_nest_duration, sizeof(topic_nest_duration), "chickens/nest%s/duration", NEST_TAG);
-  // Per-nest visit/change/leaderboard topics to avoid cross-device collisions
-  snprintf(topic_chicken_visits, sizeof(topic_chicken_visits), "chickens/nest%s/visits", NEST_TAG);
-  snprintf(topic_chicken_leaderboard, sizeof(topic_chicken_leaderboard), "chickens/nest%s/leaderboard", NEST_TAG);
-  snprintf(topic_chicken_changes, sizeof(topic_chicken_changes), "chickens/nest%s/changes", NEST_TAG);
-  snprintf(topic_system_status, sizeof(topic_system_status), "chickens/nest%s/system/status", NEST_TAG);
-}
+// Nests served by this board, one EL125 per UART: -DNEST_COUNT=2 -DNEST2_TAG=\"B\"
+// UART0 is the serial console, which leaves UART1 and UART2 for readers on an ESP32.
+#ifndef NEST_COUNT
+#define NEST_COUNT 1
+#endif
+#ifndef NEST2_TAG
+#define NEST2_TAG "B"
+#endif
+#ifndef NEST2_RX_PIN
+#define NEST2_RX_PIN 26     // GPIO26 - connect to the second RFID TX
+#endif
+#ifndef NEST2_RESET_PIN
+#define NEST2_RESET_PIN 27  // GPIO27 - connect to the second RFID RES pin
+#endif
+static_assert(NEST_COUNT >= 1 && NEST_COUNT <= SOC_UART_NUM - 1, "One UART per reader, UART0 is the console");
 
 // MQTT Client
 WiFiClient espClient;
 PubSubClient mqtt(espClient);
 
-// Scoring System Variables
-struct ChickenStats {
-  int visits;
-  unsigned long totalTime;
-  unsigned long lastVisit;
-  String name;
-};
-
-ChickenStats chickenStats[15]; // One for each chicken in database
-
 // RFID Reader Configuration for ESP32 D1 Mini
 #define RFID_RX_PIN 16      // GPIO16 (D0) - connect to RFID TX
 #define RFID_TX_PIN 17      // GPIO17 (D1) - not used (EL125 has no RX)
 #define RFID_RESET_PIN 18   // GPIO18 - connect to RFID RES pin
 #define RFID_BAUD 9600
 
-// Signal strengthening settings
-#define RFID_BUFFER_SIZE 256
-#define MIN_TAG_LENGTH 8
-#define MAX_TAG_LENGTH 20
-#define READ_TIMEOUT_MS 1000
-
-// Create UART for RFID communication
-HardwareSerial rfidSerial(1);
-
-// Data validation variables
-int consecutiveValidReads = 0;
-String lastValidTag = "";
-unsigned long lastValidReadTime = 0;
-
-// Smart tracking variables
-String currentChicken = "";
-unsigned long chickenEnterTime = 0;
-unsigned long lastPresenceCheck = 0;
-unsigned long lastResetTime = 0;
-bool nestOccupied = false;
-bool waitingForPresenceConfirmation = false;
-
-// Multi-chicken detection variables
-int quickChanges = 0;
-unsigned long lastChangeTime = 0;
-bool multiChickenMode = false;
-String detectedChickens[15]; // Track ALL chickens in database (expanded from 5 to 15)
-int chickenCount = 0;
-unsigned long lastMultiChickenDetection = 0; // Track when we last detected multiple chickens
-unsigned long singleChickenReadings = 0; // Count consecutive single-chicken readings
-#define MULTI_CHICKEN_TIMEOUT 60000 // 60 seconds to confirm all chickens have left
-#define SINGLE_READINGS_THRESHOLD 10 // Number of single readings before considering exit
-
-// Chicken Database - Add your real chickens here
-struct Chicken {
-  String tagID;
-  String name;
-  int number;
+// EL125 UARTs, driven by the ESP-IDF driver: each RFID task blocks on its event queue and
+// wakes when the ETX byte of a frame arrives (pattern detection), not on a poll timer
+#define RFID_BUFFER_SIZE 1024      // Driver RX ring; must exceed the 128-byte hardware FIFO
+#define RFID_EVENT_QUEUE_SIZE 20
+#define RFID_PATTERN_QUEUE_SIZE 16
+
+// One attached EL125 and the nest it watches
+struct NestConfig {
+  const char* tag;
+  uart_port_t uart;
+  int rxPin;
+  int txPin;
+  int resetPin;
 };
 
-// Define your actual chickens with their real tag IDs
-Chicken chickenDatabase[] = {
-  {"2003E98C8", "Lady Kluck", 1},      // ✓ CONFIRMED - working tag
-  {"2003EF40D", "Ronny", 2},           // ✓ SCANNED - new tag added
-  {"2003F2676", "Ada", 3},             // ✓ SCANNED - new tag added
-  {"2003E98F1", "Ms.Foster", 4},       // ✓ SCANNED - new tag added
-  {"2003E586A", "Kiwi", 5},            // ✓ SCANNED - new tag added
-  {"2003E956D", "Skrik", 6},           // ✓ SCANNED - new tag added
-  {"200336896", "Lady Klick", 7},      // ✓ SCANNED - updated name (was Panik)
-  {"20032D5A4A", "Gästrid", 8},        // ✓ SCANNED - new tag added (note: 10 chars)
-  {"2003E66AE", "Chick_1_2025", 9},    // ✓ SCANNED - new tag added
-  {"2003E58C1", "Chick_2_2025", 10},   // ✓ SCANNED - new tag added
-  {"2003E609A", "Chick_3_2025", 11},   // ✓ SCANNED - new tag added
-  {"2003F3CA0", "Chick_4_2025", 12},   // ✓ SCANNED - new tag added
-  {"2003E6C2F", "Chick_5_2025", 13},   // ✓ SCANNED - new tag added
-  {"2003E9525", "Chick_6_2025", 14},   // ✓ SCANNED - new tag added
-  {"2003E81EE", "Tuppen", 15},         // ✓ SCANNED - new tag added
-  // All 15 chickens now have valid tags!
+static const NestConfig nestConfigs[NEST_COUNT] = {
+  { NEST_TAG, UART_NUM_1, RFID_RX_PIN, RFID_TX_PIN, RFID_RESET_PIN },
+#if NEST_COUNT >= 2
+  { NEST2_TAG, UART_NUM_2, NEST2_RX_PIN, UART_PIN_NO_CHANGE, NEST2_RESET_PIN },
+#endif
 };
 
-int totalChickens = sizeof(chickenDatabase) / sizeof(chickenDatabase[0]);
+// Task layout: RFID acquisition and tracking on the application core,
+// WiFi/MQTT on the protocol core next to the WiFi stack
+#define RFID_TASK_CORE 1
+#define TRACKER_TASK_CORE 1
+#define NETWORK_TASK_CORE 0
+#define RFID_TASK_PRIORITY 3
+#define TRACKER_TASK_PRIORITY 2
+#define NETWORK_TASK_PRIORITY 1
+#define LOG_TASK_PRIORITY 0        // Console output only when nothing else wants the CPU
+#define LOG_TASK_CORE 0
+#define TRACKER_MIN_IDLE_MS 10    // Floor for the tracker's sleep, so a stuck deadline can't spin
+#define MQTT_KEEPALIVE_S 15       // PubSubClient's default, set explicitly: the network task sleeps by it
+#define NETWORK_FALLBACK_POLL_MS 100 // Network task poll period when the wake-up eventfd is unavailable
+
+// Acquisition side of one reader. RFID task -> tracker task: decoded frames
+struct RfidReader {
+  const NestConfig* config;
+  QueueHandle_t events;
+  El125Parser parser;
+  SpscRing<TagEvent, 32> tagEvents;
+  volatile uint32_t tagEventsDropped;
+  volatile uint32_t uartOverflows;
+};
 
-// Function forward declarations
-void updateChickenStats(int chickenNumber, unsigned long duration);
-void publishLeaderboard();
-void publishChickenChange(String previousChicken, String newChicken, unsigned long duration);
-void publishSimpleOccupants(); // NEW: Simple comma-separated occupants
-Chicken* findChickenByTag(String tagID);
+volatile uint32_t publishFailures = 0;
 
-// WiFi connection function
-void connectWiFi() {
-  WiFi.begin(ssid, password);
-  Serial.print("Connecting to WiFi");
-  
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
-  }
-  
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println();
-    Serial.println("WiFi connected!");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
-  } else {
-    Serial.println();
-    Serial.println("WiFi connection failed!");
-  }
-}
+// Network task -> metrics: the ConnectionManager itself is only touched by the network task
+volatile ConnectionManager::State connectionState = ConnectionManager::BACKOFF;
+volatile uint32_t connectionReconnects = 0;
+volatile uint32_t connectionFailures = 0;
 
-// MQTT connection function
-void connectMQTT() {
-  while (!mqtt.connected()) {
-    Serial.print("Attempting MQTT connection...");
-    
-  if (mqtt.connect(mqtt_client_id, mqtt_user, mqtt_password)) {
-      Serial.println("connected");
-      
-      // Publish system online status
-      mqtt.publish(topic_system_status, "online");
-      
-    } else {
-      Serial.print("failed, rc=");
-      Serial.print(mqtt.state());
-      Serial.println(" try again in 5 seconds");
-      delay(5000);
-    }
+// Tracker task -> network task: outgoing MQTT messages
+PublishRing publishRing;
+QueuedPublisher queuedPublisher(publishRing);
+
+// Tracker task -> log task: tracking debug lines, written to Serial off the tracking path
+LogRing logRing;
+QueuedLog queuedLog(logRing);
+
+TaskHandle_t trackerTaskHandle = nullptr;
+TaskHandle_t networkTaskHandle = nullptr;
+TaskHandle_t logTaskHandle = nullptr;
+
+// Tracker -> network task wake-up. An eventfd, so the network task can wait on it and on the
+// MQTT socket in one select(); -1 = not available, task notifications and polling instead.
+int networkWakeFd = -1;
+
+static void wakeNetworkTask() {
+  if (networkWakeFd >= 0) {
+    uint64_t one = 1;
+    write(networkWakeFd, &one, sizeof(one));
+  } else if (networkTaskHandle) {
+    xTaskNotifyGive(networkTaskHandle);
   }
 }
 
-// Function to ensure MQTT connection
-void ensureMQTTConnection() {
-  if (!mqtt.connected()) {
-    connectMQTT();
+// Arduino implementations of the tracking HAL
+class ArduinoClock : public HalClock {
+public:
+  unsigned long millis() override { return ::millis(); }
+  void delay(unsigned long ms) override { ::delay(ms); }
+  unsigned long micros() override { return ::micros(); }
+
+  uint32_t epochSeconds() override {
+    time_t now = time(nullptr);
+    return now > 1700000000 ? (uint32_t)now : 0; // Still near 1970 until SNTP has synced
   }
-  mqtt.loop();
-}
+};
 
-// Function to publish nest status
-void publishNestStatus(String status, String occupant = "", int duration = 0) {
-  if (!mqtt.connected()) return;
-  
-  // Create JSON payload
-  JsonDocument doc;
-  doc["status"] = status;
-  doc["timestamp"] = millis();
-  
-  if (occupant != "") {
-    doc["occupant"] = occupant;
+class ArduinoResetPin : public HalResetPin {
+public:
+  void begin(int resetPin) {
+    pin = resetPin;
+    pinMode(pin, OUTPUT);
   }
-  
-  // If multiple chickens detected, add the specific chicken list
-  if (status == "multiple" && chickenCount > 0) {
-    JsonArray chickens = doc["chickens"].to<JsonArray>();
-    for (int i = 0; i < chickenCount; i++) {
-      Chicken* chicken = findChickenByTag(detectedChickens[i]);
-      if (chicken) {
-        chickens.add(chicken->name);
-      }
-    }
-    doc["chicken_count"] = chickenCount;
-    
-    // Also create a comma-separated list for the occupant field
-    String chickenList = "";
-    for (int i = 0; i < chickenCount; i++) {
-      Chicken* chicken = findChickenByTag(detectedChickens[i]);
-      if (chicken) {
-        if (i > 0) chickenList += ", ";
-        chickenList += chicken->name;
-      }
+
+  void write(bool high) override { digitalWrite(pin, high ? HIGH : LOW); }
+
+private:
+  int pin = -1;
+};
+
+// NVS budget: the registry blob plus two stats records per nest, in the nvs partition of
+// partitions.csv. An NVS page is 4 KB holding 126 32-byte entries (~4000 data bytes after blob
+// chunk headers), one page stays free for garbage collection, and a rewritten blob is written
+// in full before the old copy is erased. The default 20 KB partition is too small at 384 chickens.
+#define NVS_PARTITION_SIZE 0x15000
+#define NVS_PAGE_DATA 4000
+#define NVS_DATA_CAPACITY ((NVS_PARTITION_SIZE / 4096 - 1) * NVS_PAGE_DATA)
+#define NVS_BLOB_MAX (NVS_PARTITION_SIZE / 1000 * 976 - 4000) // ESP-IDF: 97.6% of the partition - 4000
+static_assert(REGISTRY_BLOB_MAX <= NVS_BLOB_MAX, "Registry blob larger than one NVS blob: grow nvs in partitions.csv");
+static_assert(2 * REGISTRY_BLOB_MAX + NEST_COUNT * 2 * STATS_RECORD_MAX <= NVS_DATA_CAPACITY,
+              "Registry and stats records don't fit in NVS: grow nvs in partitions.csv or lower MAX_CHICKENS");
+
+// Chicken stats and other small state in the "chickens" NVS namespace.
+// NVS spreads writes over its pages itself; StatsStore batches them.
+class NvsStorage : public HalStorage {
+public:
+  bool begin() { return ready = prefs.begin("chickens", false); }
+
+  size_t load(const char* key, void* data, size_t size) override {
+    if (!ready || !prefs.isKey(key)) return 0;
+    size_t length = prefs.getBytesLength(key);
+    if (length == 0 || length > size) return 0;
+    return prefs.getBytes(key, data, length);
+  }
+
+  bool save(const char* key, const void* data, size_t size) override {
+    return ready && prefs.putBytes(key, data, size) == size;
+  }
+
+private:
+  Preferences prefs;
+  bool ready = false;
+};
+
+// Platform counters for the metrics payload: frames per reader, the rest shared by all nests
+class Esp32Diagnostics : public HalDiagnostics {
+public:
+  void begin(const RfidReader* rfidReader) { reader = rfidReader; }
+
+  void collect(PlatformDiagnostics& out) override {
+    out.framesReceived = reader->parser.framesAccepted();
+    out.framesRejected = reader->parser.framesRejected();
+    out.framesDropped = reader->tagEventsDropped;
+    out.uartOverflows = reader->uartOverflows;
+    out.publishFailures = publishFailures + queuedPublisher.droppedCount();
+    out.connectionState = ConnectionManager::stateName(connectionState);
+    out.reconnects = connectionReconnects;
+    out.connectFailures = connectionFailures;
+    out.freeHeap = ESP.getFreeHeap();
+    out.minFreeHeap = ESP.getMinFreeHeap();
+    out.largestFreeBlock = ESP.getMaxAllocHeap();
+  }
+
+private:
+  const RfidReader* reader = nullptr;
+};
+
+ArduinoClock arduinoClock;
+NvsStorage nvsStorage;
+
+// Optional compact payloads: -DCOMPACT_PAYLOADS=1 sends visits and changes as MessagePack
+// (see NestTracker.h) for the coop aggregator. The status topic stays JSON for Home Assistant.
+#ifndef COMPACT_PAYLOADS
+#define COMPACT_PAYLOADS 0
+#endif
+
+// Optional flash spill for the visit/change outbox: -DOUTBOX_FLASH_SPILL=1
+// Extends the RAM outbox with a LittleFS file for long outages. Spilled events survive a reboot.
+#ifndef OUTBOX_FLASH_SPILL
+#define OUTBOX_FLASH_SPILL 0
+#endif
+
+#if OUTBOX_FLASH_SPILL
+#define OUTBOX_SPILL_PATH "/outbox%s.bin" // Per nest: /outbox.bin, /outbox_B.bin, ...
+#define OUTBOX_SPILL_MAX_RECORDS 2048 // 32 KB of flash per nest
+
+// File layout: read position (uint32_t, records already taken back), then the records
+class FlashOutboxSpill : public OutboxSpill {
+public:
+  bool begin(const char* suffix) {
+    snprintf(path, sizeof(path), OUTBOX_SPILL_PATH, suffix);
+    if (!LittleFS.begin(true)) return false;
+    ready = true;
+
+    // Pick up what a previous boot left. Its timestamps are that boot's uptime, so those
+    // records are sent with timestamp 0 (unknown) rather than a time that means nothing now.
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) return true;
+    size_t bytes = file.size();
+    uint32_t position = 0;
+    bool ok = bytes >= sizeof(position) && (bytes - sizeof(position)) % sizeof(OutboxRecord) == 0 &&
+              file.read((uint8_t*)&position, sizeof(position)) == sizeof(position);
+    file.close();
+    written = ok ? (bytes - sizeof(position)) / sizeof(OutboxRecord) : 0;
+    if (!ok || position > written || written > OUTBOX_SPILL_MAX_RECORDS) {
+      clear(); // Not ours, or torn: start over
+      return true;
     }
-    doc["occupant"] = chickenList;
-    occupant = chickenList; // Update occupant for the separate topic
+    readIndex = position;
+    earlierBoot = written;
+    return true;
   }
-  
-  if (duration > 0) {
-    doc["duration"] = duration;
+
+  bool append(const OutboxRecord& record) override {
+    if (!ready || written >= OUTBOX_SPILL_MAX_RECORDS) return false;
+    File file = LittleFS.open(path, FILE_APPEND);
+    if (!file) return false;
+    uint32_t position = readIndex;
+    bool ok = (file.size() > 0 || file.write((const uint8_t*)&position, sizeof(position)) == sizeof(position)) &&
+              file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    file.close();
+    if (ok) written++;
+    return ok;
+  }
+
+  bool takeOldest(OutboxRecord& record) override {
+    if (size() == 0) return false;
+    File file = LittleFS.open(path, "r+");
+    if (!file) return false;
+    uint32_t position = readIndex + 1;
+    bool ok = file.seek(sizeof(position) + readIndex * sizeof(record)) &&
+              file.read((uint8_t*)&record, sizeof(record)) == sizeof(record) &&
+              file.seek(0) && file.write((const uint8_t*)&position, sizeof(position)) == sizeof(position);
+    file.close();
+    if (!ok) return false;
+    if (readIndex < earlierBoot) record.timestampMs = 0;
+
+    // Start a fresh file once everything spilled has been read back
+    if (++readIndex == written) clear();
+    return true;
   }
-  
-  String payload;
-  serializeJson(doc, payload);
-  
-  mqtt.publish(topic_nest_status, payload.c_str());
-  mqtt.publish(topic_nest_occupant, occupant.c_str());
-  
-  // NEW: Also publish simple occupants format
-  publishSimpleOccupants();
-  
-  // Debug output
-  Serial.println("MQTT Published:");
-  Serial.println("  Topic: " + String(topic_nest_status) + " | Payload: " + payload);
-  Serial.println("  Topic: " + String(topic_nest_occupant) + " | Payload: " + occupant);
-  
-  if (duration > 0) {
-    mqtt.publish(topic_nest_duration, String(duration).c_str());
-    Serial.println("  Topic: " + String(topic_nest_duration) + " | Payload: " + String(duration));
+
+  uint32_t size() override { return written - readIndex; }
+
+  void clear() override {
+    LittleFS.remove(path);
+    readIndex = written = earlierBoot = 0;
   }
-}
 
-// Function to publish chicken visit data
-void publishChickenVisit(String chickenName, int chickenNumber, unsigned long duration) {
-  if (!mqtt.connected()) return;
-  
-  JsonDocument doc;
-  doc["chicken_name"] = chickenName;
-  doc["chicken_number"] = chickenNumber;
-  doc["duration"] = duration;
-  doc["timestamp"] = millis();
-  doc["date"] = "2025-07-26"; // You might want to use NTP for real dates
-  
-  String payload;
-  serializeJson(doc, payload);
-  
-  mqtt.publish(topic_chicken_visits, payload.c_str());
-  
-  // Update chicken stats
-  updateChickenStats(chickenNumber, duration);
-}
+private:
+  char path[24];
+  bool ready = false;
+  uint32_t written = 0;
+  uint32_t readIndex = 0;
+  uint32_t earlierBoot = 0; // Records before this index were spilled by a previous boot
+};
+#endif
 
-// Function to publish chicken change events
-void publishChickenChange(String previousChicken, String newChicken, unsigned long duration) {
-  if (!mqtt.connected()) return;
-  
-  JsonDocument doc;
-  doc["event"] = "chicken_change";
-  doc["previous_chicken"] = previousChicken;
-  doc["new_chicken"] = newChicken;
-  doc["previous_duration"] = duration;
-  doc["timestamp"] = millis();
-  doc["date"] = "2025-07-26";
-  
-  String payload;
-  serializeJson(doc, payload);
-  
-  mqtt.publish(topic_chicken_changes, payload.c_str());
-}
+// Visit history segments on LittleFS: /visits/<segment>.seg, /visits_B/<segment>.seg, ...
+#define VISIT_LOG_DIR "/visits%s"
 
-// NEW: Function to publish simple comma-separated occupants format
-void publishSimpleOccupants() {
-  if (!mqtt.connected()) return;
-  
-  String occupantsList = "";
-  
-  if (!nestOccupied) {
-    // Empty nest
-    occupantsList = "Empty";
-  } else if (multiChickenMode && chickenCount > 0) {
-    // Multiple chickens - create comma-separated list
-    for (int i = 0; i < chickenCount; i++) {
-      Chicken* chicken = findChickenByTag(detectedChickens[i]);
-      if (chicken) {
-        if (i > 0) occupantsList += ",";
-        occupantsList += chicken->name;
+class FlashVisitLogFiles : public VisitLogFiles {
+public:
+  bool begin(const char* suffix) {
+    snprintf(dirPath, sizeof(dirPath), VISIT_LOG_DIR, suffix);
+    if (!LittleFS.begin(true)) return false;
+    if (!LittleFS.exists(dirPath) && !LittleFS.mkdir(dirPath)) return false;
+    return true;
+  }
+
+  bool range(uint32_t& first, uint32_t& last) override {
+    File dir = LittleFS.open(dirPath);
+    if (!dir) return false;
+    bool found = false;
+    File file;
+    while ((file = dir.openNextFile())) {
+      unsigned segment;
+      if (sscanf(file.name(), "%8x.seg", &segment) == 1) {
+        if (!found || segment < first) first = segment;
+        if (!found || segment > last) last = segment;
+        found = true;
       }
+      file.close();
     }
-  } else {
-    // Single chicken
-    Chicken* chicken = findChickenByTag(currentChicken);
-    if (chicken) {
-      occupantsList = chicken->name;
-    } else {
-      occupantsList = "Empty";
-    }
+    return found;
   }
-  
-  // Publish simple format to new topic
-  mqtt.publish(topic_nest_occupants, occupantsList.c_str());
-  
-  Serial.println("MQTT Simple Occupants: " + String(topic_nest_occupants) + " | " + occupantsList);
-}
 
-// Function to update chicken statistics
-void updateChickenStats(int chickenNumber, unsigned long duration) {
-  if (chickenNumber < 1 || chickenNumber > 15) return;
-  
-  int index = chickenNumber - 1;
-  chickenStats[index].visits++;
-  chickenStats[index].totalTime += duration;
-  chickenStats[index].lastVisit = millis();
-  chickenStats[index].name = chickenDatabase[index].name;
-  
-  // Publish updated leaderboard every 10 visits across all chickens
-  static int totalVisits = 0;
-  totalVisits++;
-  if (totalVisits % 10 == 0) {
-    publishLeaderboard();
+  uint32_t size(uint32_t segment) override {
+    File file = LittleFS.open(path(segment), FILE_READ);
+    if (!file) return 0;
+    uint32_t bytes = file.size();
+    file.close();
+    return bytes;
   }
-}
 
-// Function to publish leaderboard
-void publishLeaderboard() {
-  if (!mqtt.connected()) return;
-  
-  JsonDocument doc;
-  JsonArray leaderboard = doc["leaderboard"].to<JsonArray>();
-  
-  // Create array of chicken stats for sorting
-  ChickenStats sortedStats[15];
-  for (int i = 0; i < 15; i++) {
-    sortedStats[i] = chickenStats[i];
+  size_t read(uint32_t segment, uint32_t offset, void* data, size_t size) override {
+    File file = LittleFS.open(path(segment), FILE_READ);
+    if (!file) return 0;
+    size_t bytes = file.seek(offset) ? file.read((uint8_t*)data, size) : 0;
+    file.close();
+    return bytes;
   }
-  
-  // Simple bubble sort by visit count
-  for (int i = 0; i < 14; i++) {
-    for (int j = 0; j < 14 - i; j++) {
-      if (sortedStats[j].visits < sortedStats[j + 1].visits) {
-        ChickenStats temp = sortedStats[j];
-        sortedStats[j] = sortedStats[j + 1];
-        sortedStats[j + 1] = temp;
-      }
-    }
+
+  bool append(uint32_t segment, const void* data, size_t size) override {
+    File file = LittleFS.open(path(segment), FILE_APPEND);
+    if (!file) return false;
+    bool ok = file.write((const uint8_t*)data, size) == size;
+    file.close();
+    return ok;
   }
-  
-  // Add top 10 to JSON
-  for (int i = 0; i < 10 && i < 15; i++) {
-    if (sortedStats[i].visits > 0) {
-      JsonObject chicken = leaderboard.add<JsonObject>();
-      chicken["rank"] = i + 1;
-      chicken["name"] = sortedStats[i].name;
-      chicken["visits"] = sortedStats[i].visits;
-      chicken["total_time"] = sortedStats[i].totalTime;
-      chicken["avg_time"] = sortedStats[i].visits > 0 ? sortedStats[i].totalTime / sortedStats[i].visits : 0;
-    }
+
+  bool remove(uint32_t segment) override { return LittleFS.remove(path(segment)); }
+
+private:
+  const char* path(uint32_t segment) {
+    snprintf(pathBuffer, sizeof(pathBuffer), "%s/%08x.seg", dirPath, (unsigned)segment);
+    return pathBuffer;
   }
-  
-  doc["updated"] = millis();
-  
-  String payload;
-  serializeJson(doc, payload);
-  
-  mqtt.publish(topic_chicken_leaderboard, payload.c_str());
+  char dirPath[16];
+  char pathBuffer[32];
+};
+
+// Everything one attached reader needs; the WiFi/MQTT stack and storage are shared
+struct Nest {
+  RfidReader reader;
+  char storageSuffix[NEST_TAG_MAX + 1]; // "" for the first nest, so its keys and files predate multi-nest boards
+  ArduinoResetPin resetPin;
+  Esp32Diagnostics diagnostics;
+  FlashVisitLogFiles visitLogFiles;
+#if OUTBOX_FLASH_SPILL
+  FlashOutboxSpill outboxSpill;
+#endif
+  NestTracker tracker;
+};
+
+Nest nests[NEST_COUNT];
+
+// Build a unique client ID per device using the nest tags + MAC (no colons)
+static char mqtt_client_id[64];
+static void buildClientId() {
+  char tags[NEST_COUNT * NEST_TAG_MAX] = "";
+  for (int i = 0; i < NEST_COUNT; i++) strlcat(tags, nestConfigs[i].tag, sizeof(tags));
+  String mac = WiFi.macAddress(); // format: XX:XX:XX:XX:XX:XX
+  mac.replace(":", "");
+  snprintf(mqtt_client_id, sizeof(mqtt_client_id), "chicken_%s_%s", tags, mac.c_str());
 }
 
-void setup() {
-  Serial.begin(115200);
-  delay(2000);
-  
-  Serial.println("=== Smart Chicken RFID Monitor v3.0 ===");
-  Serial.println("ESP32 D1 Mini - 15 Chicken System");
-  Serial.println("Features: Enter/Exit tracking, MQTT, Scoring");
-  Serial.println();
+// WiFi/MQTT operations for the connection manager - none of them wait for the network
+class ArduinoNetworkLink : public NetworkLink {
+public:
+  void wifiBegin() override {
+    Serial.println("Connecting to WiFi...");
+    WiFi.disconnect();
+    WiFi.begin(ssid, password);
+  }
 
-  // Initialize topics and unique MQTT client id early
-  initTopics();
-  buildClientId();
-  
-  // Initialize chicken stats
-  for (int i = 0; i < 15; i++) {
-    chickenStats[i].visits = 0;
-    chickenStats[i].totalTime = 0;
-    chickenStats[i].lastVisit = 0;
-    chickenStats[i].name = chickenDatabase[i].name;
+  bool wifiConnected() override { return WiFi.status() == WL_CONNECTED; }
+
+  bool mqttConnect() override {
+    Serial.print("Attempting MQTT connection...");
+    if (mqtt.connect(mqtt_client_id, mqtt_user, mqtt_password)) {
+      Serial.println("connected");
+      return true;
+    }
+    Serial.print("failed, rc=");
+    Serial.println(mqtt.state());
+    return false;
   }
-  
-  // Setup reset pin
-  pinMode(RFID_RESET_PIN, OUTPUT);
-  digitalWrite(RFID_RESET_PIN, HIGH); // Keep reader active
-  
-  // Initialize RFID Serial with improved settings
-  rfidSerial.begin(RFID_BAUD, SERIAL_8N1, RFID_RX_PIN, RFID_TX_PIN);
-  rfidSerial.setRxBufferSize(RFID_BUFFER_SIZE); // Larger buffer for better reliability
-  delay(500);
-  
-  // Additional UART stability settings
-  Serial.println("RFID UART Buffer Size: " + String(RFID_BUFFER_SIZE));
-  Serial.println("Signal validation: Enabled");
-  
-  // Connect to WiFi
-  connectWiFi();
-  
-  // Setup MQTT
-  mqtt.setServer(mqtt_server, mqtt_port);
-  connectMQTT();
-  
-  Serial.println("System Status: READY");
-  Serial.print("Monitoring: Nesting Box #");
-  Serial.println(NEST_TAG);
-  Serial.println("Smart Logic: Enter/Exit detection");
-  Serial.println("Reset Control: Enabled on GPIO18");
-  Serial.println("MQTT: Connected to Home Assistant");
-  Serial.println("Scoring: Active");
-  Serial.println("Note: EL125 is read-only (no RX pin)");
-  Serial.println("=====================================");
-  
-  // Publish initial system status
-  publishNestStatus("empty");
+
+  bool mqttConnected() override { return mqtt.connected(); }
+};
+
+ArduinoNetworkLink networkLink;
+ConnectionManager connection(networkLink, esp_random());
+
+// Install the UART driver with an event queue and ETX pattern detection
+static bool rfidUartBegin(RfidReader& reader) {
+  const NestConfig& nest = *reader.config;
+  uart_config_t config = {};
+  config.baud_rate = RFID_BAUD;
+  config.data_bits = UART_DATA_8_BITS;
+  config.parity = UART_PARITY_DISABLE;
+  config.stop_bits = UART_STOP_BITS_1;
+  config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+  config.source_clk = UART_SCLK_APB;
+
+  if (uart_driver_install(nest.uart, RFID_BUFFER_SIZE, 0, RFID_EVENT_QUEUE_SIZE, &reader.events, 0) != ESP_OK) return false;
+  if (uart_param_config(nest.uart, &config) != ESP_OK) return false;
+  if (uart_set_pin(nest.uart, nest.txPin, nest.rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) return false;
+
+  // One ETX ends a frame. EL125 frames are sent back to back, so no idle time is required around it.
+  uart_enable_pattern_det_baud_intr(nest.uart, EL125_ETX, 1, 9, 0, 0);
+  uart_pattern_queue_reset(nest.uart, RFID_PATTERN_QUEUE_SIZE);
+  return true;
 }
 
-// Function to reset the RFID reader to force a new read
-void resetReader() {
-  Serial.println("→ Resetting RFID reader for fresh read...");
-  
-  // Clear any pending data first
-  while (rfidSerial.available()) {
-    rfidSerial.read();
+// Feed everything the driver has buffered into the frame parser
+static void rfidDrain(RfidReader& reader) {
+  uart_port_t uart = reader.config->uart;
+  uint8_t chunk[64];
+  size_t buffered = 0;
+  uart_get_buffered_data_len(uart, &buffered);
+  while (buffered > 0) {
+    int length = uart_read_bytes(uart, chunk, buffered < sizeof(chunk) ? buffered : sizeof(chunk), 0);
+    if (length <= 0) break;
+    buffered -= length;
+
+    for (int i = 0; i < length; i++) {
+      if (reader.parser.feed(chunk[i]) != El125Parser::FRAME) {
+        continue;
+      }
+      TagEvent event = { reader.parser.tag(), millis() };
+      if (reader.tagEvents.push(event)) {
+        xTaskNotifyGive(trackerTaskHandle);
+      } else {
+        reader.tagEventsDropped++;
+      }
+    }
   }
-  
-  // Reset the reader with extended timing for stationary tag detection
-  digitalWrite(RFID_RESET_PIN, LOW);   // Reset the reader
-  delay(200);                          // Longer reset hold for complete power cycle
-  digitalWrite(RFID_RESET_PIN, HIGH);  // Release reset
-  delay(1000);                         // Extended restart time for EL125 to stabilize and begin multiple scan cycles
-  
-  // Clear validation state to force fresh detection
-  consecutiveValidReads = 0;
-  lastValidTag = "";
-  
-  Serial.println("✓ RFID reader reset complete - extended scanning window active...");
 }
 
-// Function to extract readable tag ID from raw RFID data with validation
-String extractTagID(String rawData) {
-  // Clean the data first
-  rawData.trim();
-  rawData.toUpperCase();
-  
-  // Check if this is ASCII-encoded format (starts with 02 and ends with 03)
-  if (rawData.startsWith("02") && rawData.endsWith("03") && rawData.length() >= 6) {
-    // Remove start (02) and end (03) bytes
-    String asciiHex = rawData.substring(2, rawData.length() - 2);
-    
-    // Convert ASCII hex to actual string
-    String tagID = "";
-    for (int i = 0; i < asciiHex.length(); i += 2) {
-      if (i + 1 < asciiHex.length()) {
-        String hexPair = asciiHex.substring(i, i + 2);
-        char c = (char)strtol(hexPair.c_str(), NULL, 16);
-        if (c >= 32 && c <= 126) { // Printable ASCII
-          tagID += c;
+// RFID acquisition task, one per reader: sleeps on the UART event queue and decodes a frame
+// as soon as its ETX arrives, timestamping it right there. Nothing in here waits on the network,
+// so a slow broker can't make us miss a read.
+void rfidTask(void* parameter) {
+  RfidReader& reader = *(RfidReader*)parameter;
+  uart_port_t uart = reader.config->uart;
+  for (;;) {
+    uart_event_t event;
+    if (xQueueReceive(reader.events, &event, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    switch (event.type) {
+      case UART_PATTERN_DET:
+        // Positions aren't needed: the parser finds frame boundaries itself
+        while (uart_pattern_pop_pos(uart) != -1) {
         }
-      }
+        rfidDrain(reader);
+        break;
+      case UART_DATA:
+        rfidDrain(reader); // Partial frame or noise; keeps the ring from filling up
+        break;
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL:
+        // Bytes were lost: whatever frame was in flight is broken
+        reader.uartOverflows++;
+        uart_flush_input(uart);
+        xQueueReset(reader.events);
+        uart_pattern_queue_reset(uart, RFID_PATTERN_QUEUE_SIZE);
+        reader.parser.reset();
+        break;
+      default:
+        break; // Framing/parity errors show up as rejected frames
     }
-    
-    // Extract clean tag ID - remove non-hex characters and standardize format
-    String cleanTagID = "";
-    
-    // Only keep valid hex characters
-    for (int i = 0; i < tagID.length(); i++) {
-      char c = tagID.charAt(i);
-      if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F')) {
-        cleanTagID += c;
+  }
+}
+
+// Tracker task: runs every nest's tracker. Consumes frames as soon as they arrive, otherwise
+// sleeps until the earliest tracking deadline (presence check, exit window, heartbeat, ...)
+void trackerTask(void* parameter) {
+  for (;;) {
+    // Bring Home Assistant up to date after every (re)connect
+    static bool wasConnected = false;
+    bool isConnected = queuedPublisher.connected();
+
+    unsigned long idle = TRACKING_MAX_IDLE_MS;
+    for (Nest& nest : nests) {
+      TagEvent event;
+      while (nest.reader.tagEvents.pop(event)) {
+        nest.tracker.handleTag(event.tag, event.timeMs);
       }
+      if (isConnected && !wasConnected) {
+        nest.tracker.publishStatus();
+      }
+      nest.tracker.update();
+
+      unsigned long nestIdle = nest.tracker.idleMs();
+      if (nestIdle < idle) idle = nestIdle;
     }
+    wasConnected = isConnected;
     
-    // Remove leading zeros and get the meaningful part
-    String finalTag = "";
-    bool foundStart = false;
-    for (int i = 0; i < cleanTagID.length(); i++) {
-      char c = cleanTagID.charAt(i);
-      if (!foundStart && c != '0') foundStart = true;
-      if (foundStart) finalTag += c;
+    // Hand new messages to the network task right away
+    if (publishRing.size() > 0) {
+      wakeNetworkTask();
     }
-    
-    // Ensure minimum length of 8 characters by padding with leading zeros if needed
-    while (finalTag.length() < 8 && finalTag.length() > 0) {
-      finalTag = "0" + finalTag;
+    if (logTaskHandle && logRing.size() > 0) {
+      xTaskNotifyGive(logTaskHandle);
     }
     
-    // Validate length
-    if (finalTag.length() >= 8 && finalTag.length() <= 16) {
-      return finalTag;
-    }
+    if (idle < TRACKER_MIN_IDLE_MS) idle = TRACKER_MIN_IDLE_MS;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idle));
   }
-  
-  // Fallback to old method for non-ASCII format
-  String cleanData = "";
-  for (int i = 0; i < rawData.length(); i++) {
-    char c = rawData.charAt(i);
-    if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F')) {
-      cleanData += c;
-    }
-  }
-  
-  // Validate length
-  if (cleanData.length() < MIN_TAG_LENGTH || cleanData.length() > MAX_TAG_LENGTH) {
-    return ""; // Invalid length
-  }
-  
-  // For EL125, extract the meaningful part (typically middle section)
-  if (cleanData.length() >= 10) {
-    String result = cleanData.substring(6, 16);
-    return result;
-  }
-  
-  return cleanData;
 }
 
-// Improved RFID reading with error checking and validation
-String readRFIDWithValidation() {
-  if (!rfidSerial.available()) {
-    return "";
-  }
-  
-  String rawData = "";
-  int bytesRead = 0;
-  unsigned long startTime = millis();
-  
-  // Read with timeout and validation
-  while ((millis() - startTime) < READ_TIMEOUT_MS && bytesRead < RFID_BUFFER_SIZE) {
-    if (rfidSerial.available()) {
-      uint8_t byte = rfidSerial.read();
-      bytesRead++;
-      
-      // Convert to hex
-      if (byte < 0x10) rawData += "0";
-      rawData += String(byte, HEX);
-      
-      // Small delay to ensure we get complete data
-      delay(2);
+// Incoming MQTT messages (delivered from mqtt.loop() in the network task)
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  if (strcmp(topic, REGISTRY_TOPIC) == 0) {
+    if (NestTracker::updateRegistry((const char*)payload, length)) {
+      xTaskNotifyGive(trackerTaskHandle); // Applied as soon as every nest is empty
     } else {
-      // If no more data coming and we have some, break
-      if (bytesRead > 0) {
-        delay(10); // Wait a bit more for potential additional bytes
-        if (!rfidSerial.available()) break;
-      }
+      Serial.printf("Chicken registry ignored (%u bytes, limit %d, or update pending)\n", length, REGISTRY_TEXT_MAX);
     }
+    return;
   }
-  
-  if (bytesRead == 0) {
-    return "";
-  }
-  
-  // Extract and validate tag ID
-  String tagID = extractTagID(rawData);
-  
-  if (tagID.length() == 0) {
-    return "";
-  }
-  
-  // Additional validation - must be consistent across reads
-  if (tagID == lastValidTag && (millis() - lastValidReadTime) < 2000) {
-    consecutiveValidReads++;
-  } else {
-    consecutiveValidReads = 1;
-    lastValidTag = tagID;
-  }
-  
-  lastValidReadTime = millis();
-  
-  // Only return tag if we have confident reads
-  if (consecutiveValidReads >= 1) { // Reduced from 2 to 1 for better responsiveness
-    return tagID;
-  }
-  
-  return "";
-}
 
-// Function to look up chicken by tag ID
-Chicken* findChickenByTag(String tagID) {
-  for (int i = 0; i < totalChickens; i++) {
-    if (chickenDatabase[i].tagID == tagID) {
-      return &chickenDatabase[i];
+  for (Nest& nest : nests) {
+    if (strcmp(topic, nest.tracker.leaderboardRequestTopic()) == 0) {
+      nest.tracker.requestLeaderboard();
+      xTaskNotifyGive(trackerTaskHandle);
+    } else if (strcmp(topic, nest.tracker.visitHistoryRequestTopic()) == 0) {
+      if (nest.tracker.requestVisitHistory((const char*)payload, length)) {
+        xTaskNotifyGive(trackerTaskHandle);
+      } else {
+        Serial.printf("Visit history request ignored (%u bytes, or one is pending)\n", length);
+      }
     }
   }
-  return nullptr; // Not found = garbled/unknown tag
 }
 
-// Function to validate if tag ID is a real chicken
-bool isValidChicken(String tagID) {
-  return findChickenByTag(tagID) != nullptr;
-}
-
-// Function to get chicken info string
-String getChickenInfo(String tagID) {
-  Chicken* chicken = findChickenByTag(tagID);
-  if (chicken != nullptr) {
-    return String(chicken->number) + " (" + chicken->name + ")";
+// Log task: writes queued tracker lines to Serial. At 115200 baud a line takes ~10 ms,
+// which the tracker no longer waits for.
+void logTask(void* parameter) {
+  for (;;) {
+    LogLine* line;
+    while ((line = logRing.peek()) != nullptr) {
+      Serial.println(line->text);
+      logRing.release();
+    }
+    uint32_t dropped = queuedLog.takeDropped();
+    if (dropped > 0) {
+      Serial.printf("(%u log lines dropped)\n", (unsigned)dropped);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
   }
-  return "UNKNOWN";
 }
 
-// Function to add chicken to recent detection list
-void addChickenToList(String tagID) {
-  // Only add valid chickens
-  if (!isValidChicken(tagID)) {
-    return;
+// Sleep up to timeoutMs, waking early when the tracker queued messages or (online) the broker
+// sent something. Returns true when there is data from the broker to read.
+static bool networkWait(unsigned long timeoutMs, bool online) {
+  if (networkWakeFd < 0) {
+    if (online && timeoutMs > NETWORK_FALLBACK_POLL_MS) timeoutMs = NETWORK_FALLBACK_POLL_MS;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+    return online && espClient.available() > 0;
   }
-  
-  // Check if already in list
-  for (int i = 0; i < chickenCount; i++) {
-    if (detectedChickens[i] == tagID) {
-      return; // Already in list
-    }
+
+  fd_set readable;
+  FD_ZERO(&readable);
+  FD_SET(networkWakeFd, &readable);
+  int maxFd = networkWakeFd;
+  int socket = online ? espClient.fd() : -1;
+  if (socket >= 0) {
+    FD_SET(socket, &readable);
+    if (socket > maxFd) maxFd = socket;
   }
-  
-  // Add new chicken if space available
-  if (chickenCount < 15) { // Expanded from 5 to 15 to track all chickens
-    detectedChickens[chickenCount] = tagID;
-    chickenCount++;
+
+  struct timeval timeout;
+  timeout.tv_sec = timeoutMs / 1000;
+  timeout.tv_usec = (timeoutMs % 1000) * 1000;
+  if (select(maxFd + 1, &readable, nullptr, nullptr, &timeout) <= 0) return false;
+
+  if (FD_ISSET(networkWakeFd, &readable)) {
+    uint64_t count;
+    read(networkWakeFd, &count, sizeof(count)); // Reset the counter
   }
+  return socket >= 0 && FD_ISSET(socket, &readable);
 }
 
-// Function to check for multi-chicken indicators
-bool detectMultipleChickens(String tagID, unsigned long sessionDuration) {
-  // Only process valid chickens
-  if (!isValidChicken(tagID)) {
-    return false;
-  }
-  
-  // IMPORTANT: Add the current chicken to the list first (the one already in nest)
-  // This ensures we don't lose track of the chicken that was already present
-  if (!currentChicken.isEmpty() && isValidChicken(currentChicken)) {
-    addChickenToList(currentChicken);
-  }
-  
-  // Indicator 1: Very quick changes (less than 10 seconds)
-  if (sessionDuration < 10) {
-    quickChanges++;
+// Network task: owns PubSubClient, keeps the connection up and drains the publish queue
+void networkTask(void* parameter) {
+  KeepaliveClock keepalive(MQTT_KEEPALIVE_S * 1000UL);
+  bool incoming = false;
+  for (;;) {
+    unsigned long now = millis();
+    switch (connection.update(now)) {
+      case ConnectionManager::CONNECTED_EVENT:
+        Serial.printf("MQTT connected (IP %s, reconnects: %u)\n",
+                      WiFi.localIP().toString().c_str(), (unsigned)connection.reconnectCount());
+        // Publish system online status, per nest
+        for (Nest& nest : nests) {
+          mqtt.publish(nest.tracker.systemStatusTopic(), "online");
+          mqtt.subscribe(nest.tracker.leaderboardRequestTopic());
+          mqtt.subscribe(nest.tracker.visitHistoryRequestTopic());
+        }
+        mqtt.subscribe(REGISTRY_TOPIC); // Retained: the current registry arrives on every connect
+        keepalive.connected(millis());
+        xTaskNotifyGive(trackerTaskHandle); // Publishing work may be due now
+        break;
+      case ConnectionManager::DISCONNECTED:
+        Serial.printf("MQTT connection lost (rc=%d), reconnecting\n", mqtt.state());
+        break;
+      case ConnectionManager::ATTEMPT_FAILED:
+        Serial.printf("Connection attempt %u failed, retry in %lu ms\n",
+                      (unsigned)connection.consecutiveFailures(), connection.retryAt() - now);
+        break;
+      default:
+        break;
+    }
+    connectionState = connection.state();
+    connectionReconnects = connection.reconnectCount();
+    connectionFailures = connection.failedAttempts();
     
-    // If 3+ quick changes in short time = multiple chickens
-    if (quickChanges >= 3) {
-      return true;
+    bool online = connection.connected();
+    queuedPublisher.setConnected(online);
+    
+    if (online) {
+      // PubSubClient reads one packet per loop(): drain what the broker sent, and ping when due
+      bool ping = keepalive.pingDue(millis());
+      do {
+        incoming |= espClient.available() > 0;
+        mqtt.loop();
+      } while (mqtt.connected() && espClient.available() > 0);
+      if (ping) {
+        keepalive.pinged(millis());
+      } else if (incoming) {
+        keepalive.received(millis());
+      }
+
+      PublishMessage* message;
+      bool reported = false;
+      while ((message = publishRing.peek()) != nullptr) {
+        DeliveryReceipt* receipt = message->receipt;
+        // After a failed confirmed message the rest with that receipt is held back (the tracker
+        // sends them again in order), so nothing behind a lost visit gets ahead of it
+        bool held = receipt && receipt->blocked.load();
+        bool sent = !held && mqtt.publish(message->topic, (const uint8_t*)message->payload, message->length);
+        if (sent) keepalive.sent(millis());
+        if (!sent && !held) publishFailures++;
+        if (receipt) {
+          if (sent) {
+            receipt->delivered.fetch_add(1);
+          } else {
+            receipt->blocked.store(true);
+            receipt->failed.fetch_add(1);
+          }
+          reported = true;
+        }
+        publishRing.release();
+      }
+      if (reported) xTaskNotifyGive(trackerTaskHandle); // Confirmed records can leave the outbox
     }
-  } else {
-    quickChanges = 0; // Reset counter for longer sessions
-  }
-  
-  // Indicator 2: Multiple different chickens detected recently (lowered threshold)
-  addChickenToList(tagID); // Add the new chicken too
-  if (chickenCount >= 2) { // Any 2+ chickens = multi-chicken mode
-    return true;
+    
+    // Sleep until the next reconnect step or keepalive ping, data from the broker, or a message
+    // from the tracker
+    unsigned long idle = online ? keepalive.msUntilPing(millis()) : connection.msUntilUpdate(millis());
+    incoming = idle > 0 && networkWait(idle, online);
   }
-  
-  return false;
 }
 
-// Function to reset multi-chicken detection after timeout
-void resetMultiChickenDetection() {
-  quickChanges = 0;
-  chickenCount = 0;
-  multiChickenMode = false;
-  singleChickenReadings = 0;
-  lastMultiChickenDetection = 0;
-  for (int i = 0; i < 15; i++) { // Clear all 15 slots (expanded from 5)
-    detectedChickens[i] = "";
+// Automatic light sleep while every task is blocked, waking on RFID activity.
+// Needs a framework build with power management and tickless idle enabled
+// (CONFIG_PM_ENABLE, CONFIG_FREERTOS_USE_TICKLESS_IDLE); a no-op otherwise.
+static void enableLightSleep() {
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  // The start bit of the first frame wakes the chip; the EL125 repeats frames while a tag is present
+  for (const NestConfig& nest : nestConfigs) {
+    gpio_wakeup_enable((gpio_num_t)nest.rxPin, GPIO_INTR_LOW_LEVEL);
   }
-}
+  esp_sleep_enable_gpio_wakeup();
 
-// Function to get chicken ID from tag (you can customize this mapping)
-String getChickenID(String tagID) {
-  Chicken* chicken = findChickenByTag(tagID);
-  if (chicken != nullptr) {
-    return String(chicken->number);
+  esp_pm_config_esp32_t config = {};
+  config.max_freq_mhz = 240;
+  config.min_freq_mhz = 80;
+  config.light_sleep_enable = true;
+  if (esp_pm_configure(&config) == ESP_OK) {
+    Serial.println("Power: automatic light sleep enabled");
   }
-  return "??"; // Unknown chicken
+#endif
 }
 
-void loop() {
-  // Ensure MQTT connection
-  ensureMQTTConnection();
+void setup() {
+  Serial.begin(115200);
+  delay(2000);
   
-  // Heartbeat every 5 minutes (300 seconds)
-  static unsigned long lastHeartbeat = 0;
-  if (millis() - lastHeartbeat > 300000) {
-    String status;
-    if (!nestOccupied) {
-      status = "Empty";
-      publishNestStatus("empty");
-    } else if (multiChickenMode) {
-      status = "Multiple chickens detected";
-      publishNestStatus("multiple", "multiple_chickens");
-    } else {
-      status = "Occupied by " + getChickenInfo(currentChicken);
-      Chicken* chicken = findChickenByTag(currentChicken);
-      if (chicken) {
-        publishNestStatus("occupied", chicken->name);
-      }
+  Serial.println("=== Smart Chicken RFID Monitor v3.0 ===");
+  Serial.println("ESP32 D1 Mini - Chicken Registry System");
+  Serial.println("Features: Enter/Exit tracking, MQTT, Scoring");
+  Serial.println();
+
+  // Initialize topics, tracking state and unique MQTT client id early, one tracker per reader.
+  // No UART in the tracker HAL: the RFID task owns it and hands over decoded frames.
+  HalStorage* storage = nvsStorage.begin() ? &nvsStorage : nullptr;
+#if COMPACT_PAYLOADS
+  NestTracker::setPayloadFormat(NestTracker::VISITS, NestTracker::MSGPACK);
+  NestTracker::setPayloadFormat(NestTracker::CHANGES, NestTracker::MSGPACK);
+#endif
+  bool rfidReady[NEST_COUNT];
+  for (int i = 0; i < NEST_COUNT; i++) {
+    Nest& nest = nests[i];
+    const NestConfig& config = nestConfigs[i];
+    snprintf(nest.storageSuffix, sizeof(nest.storageSuffix), i == 0 ? "" : "_%s", config.tag);
+    nest.reader.config = &config;
+    nest.resetPin.begin(config.resetPin);
+    nest.diagnostics.begin(&nest.reader);
+
+    Hal hal = { &arduinoClock, nullptr, &nest.resetPin, &queuedPublisher, &queuedLog, storage, &nest.diagnostics };
+#if OUTBOX_FLASH_SPILL
+    OutboxSpill* outboxSpill = nest.outboxSpill.begin(nest.storageSuffix) ? &nest.outboxSpill : nullptr;
+#else
+    OutboxSpill* outboxSpill = nullptr;
+#endif
+    VisitLogFiles* visitLogFiles = nest.visitLogFiles.begin(nest.storageSuffix) ? &nest.visitLogFiles : nullptr;
+    nest.tracker.begin(hal, config.tag, outboxSpill, visitLogFiles, nest.storageSuffix); // Also keeps reader active (RES high)
+
+    // Initialize the RFID UART (event driven, ETX pattern detection)
+    rfidReady[i] = rfidUartBegin(nest.reader);
+    if (!rfidReady[i]) {
+      Serial.printf("ERROR: RFID UART driver install failed (nest %s)\n", config.tag);
     }
-    Serial.println("[" + String(millis()/60000) + "min] " + status);
-    
-    // Also publish system heartbeat
-    mqtt.publish(topic_system_status, "online");
-    
-    lastHeartbeat = millis();
   }
+  buildClientId();
+  delay(500);
   
-  // Smart presence check every 30 seconds if nest is occupied
-  if (nestOccupied && (millis() - lastPresenceCheck > 30000)) {
-    String currentChickenInfo = getChickenInfo(currentChicken);
-    Serial.println("Checking if " + currentChickenInfo + " is still present...");
-    resetReader();
-    lastResetTime = millis();
-    waitingForPresenceConfirmation = true;
-    lastPresenceCheck = millis();
-  }
+  // Additional UART stability settings
+  Serial.printf("RFID UART Buffer Size: %d\n", RFID_BUFFER_SIZE);
+  Serial.println("Signal validation: Enabled");
   
-  // Check if chicken has left after reset (no detection within 8 seconds after reset)
-  if (waitingForPresenceConfirmation && (millis() - lastResetTime > 8000)) {
-    // No detection after reset = chicken has left
-    unsigned long sessionDuration = (millis() - chickenEnterTime) / 1000;
-    
-    if (multiChickenMode) {
-      Serial.println("*** MULTIPLE CHICKENS LEFT NEST! ***");
-      String lastChickenInfo = getChickenInfo(currentChicken);
-      Serial.println("Last detected: " + lastChickenInfo);
-      Serial.println("Multi-chicken session duration: " + String(sessionDuration) + " seconds");
-      
-      // Publish multi-chicken session end
-      publishNestStatus("empty");
-      
-    } else {
-      Serial.println("*** CHICKEN LEFT NEST! ***");
-      String chickenInfo = getChickenInfo(currentChicken);
-      Serial.println("Chicken: " + chickenInfo);
-      Serial.println("Session Duration: " + String(sessionDuration) + " seconds");
-      
-      // Publish single chicken visit
-      Chicken* chicken = findChickenByTag(currentChicken);
-      if (chicken) {
-        publishChickenVisit(chicken->name, chicken->number, sessionDuration);
-        publishNestStatus("empty");
-      }
-    }
-    Serial.println("Status: EMPTY");
-    Serial.println("===================");
-    
-    // Reset state
-    nestOccupied = false;
-    currentChicken = "";
-    chickenEnterTime = 0;
-    waitingForPresenceConfirmation = false;
-    resetMultiChickenDetection();
-  }
+  // Setup WiFi/MQTT - the network task connects in the background
+  WiFi.mode(WIFI_STA);
+  mqtt.setServer(mqtt_server, mqtt_port);
+  mqtt.setCallback(mqttCallback);
+  // Room for an incoming chicken registry, which is also more than the largest queued message
+  static_assert(REGISTRY_TEXT_MAX >= PUBLISH_TOPIC_MAX + PUBLISH_PAYLOAD_MAX, "MQTT buffer too small for publishing");
+  mqtt.setBufferSize(sizeof(REGISTRY_TOPIC) + REGISTRY_TEXT_MAX + 16);
+  mqtt.setSocketTimeout(5); // Bound a single connect attempt to a dead broker
+  mqtt.setKeepAlive(MQTT_KEEPALIVE_S);
+  configTime(0, 0, NTP_SERVER); // Wall clock for the visit log, synced once WiFi is up
   
-  // Check for RFID data with improved validation
-  if (rfidSerial.available()) {
-    // Use improved reading function
-    String tagID = readRFIDWithValidation();
-    
-    if (tagID.length() == 0) {
-      // Invalid or incomplete read, ignore
-      return;
-    }
-    
-    String chickenID = getChickenID(tagID);
-    String chickenInfo = getChickenInfo(tagID);
-    unsigned long currentTime = millis();
-    
-    // Check if this is a valid chicken
-    if (!isValidChicken(tagID)) {
-      Serial.println("! Unknown tag: " + tagID + " (ignored)");
-      return; // Ignore unknown chickens
-    }
-    
-    if (!nestOccupied) {
-      // Chicken entering nest
-      nestOccupied = true;
-      currentChicken = tagID; // Store the full tag ID
-      chickenEnterTime = currentTime;
-      lastPresenceCheck = currentTime;
-      waitingForPresenceConfirmation = false; // Not waiting when chicken enters
-      
-      Serial.println("*** CHICKEN ENTERED NEST! ***");
-      Serial.println("Chicken: " + chickenInfo + " | Tag: " + tagID);
-      Serial.println("Time: " + String(currentTime/1000) + "s");
-      Serial.println("Status: OCCUPIED");
-      Serial.println("===================");
-      
-      // Publish chicken entry
-      Chicken* chicken = findChickenByTag(tagID);
-      if (chicken) {
-        publishNestStatus("occupied", chicken->name);
-      }
-      
-    } else if (currentChicken == tagID) {
-      // Same chicken still present - just update check time
-      lastPresenceCheck = currentTime;
-      waitingForPresenceConfirmation = false; // Cancel the waiting state
-      
-      // IMPORTANT: Handle multi-chicken mode carefully due to hardware limitations
-      if (multiChickenMode) {
-        // Increment counter for consecutive single-chicken readings
-        singleChickenReadings++;
-        
-        // Only exit multi-chicken mode after many consecutive single readings
-        // AND enough time has passed to be confident other chickens have left
-        if (singleChickenReadings >= SINGLE_READINGS_THRESHOLD && 
-            (millis() - lastMultiChickenDetection) > MULTI_CHICKEN_TIMEOUT) {
-          
-          Serial.println("*** EXITING MULTI-CHICKEN MODE ***");
-          Serial.println("Only " + chickenInfo + " detected for " + String(singleChickenReadings) + " consecutive readings");
-          Serial.println("Time since last multi-chicken activity: " + String((millis() - lastMultiChickenDetection)/1000) + "s");
-          
-          // Reset multi-chicken detection
-          resetMultiChickenDetection();
-          multiChickenMode = false;
-          singleChickenReadings = 0;
-          
-          // Publish single chicken status
-          Chicken* chicken = findChickenByTag(tagID);
-          if (chicken) {
-            publishNestStatus("occupied", chicken->name);
-            Serial.println("MQTT: Updated to single chicken mode - " + chicken->name);
-          }
-          
-          Serial.println("Status: OCCUPIED BY SINGLE CHICKEN");
-          Serial.println("===================");
-        } else {
-          // Still in multi-chicken mode, just show progress
-          Serial.println("✓ " + chickenInfo + " detected (single reading #" + String(singleChickenReadings) + 
-                        "/" + String(SINGLE_READINGS_THRESHOLD) + ", timeout in " + 
-                        String((MULTI_CHICKEN_TIMEOUT - (millis() - lastMultiChickenDetection))/1000) + "s)");
-        }
-      } else {
-        Serial.println("✓ " + chickenInfo + " confirmed present");
-      }
-      
-    } else {
-      // Different chicken detected while nest occupied
-      unsigned long sessionDuration = (currentTime - chickenEnterTime) / 1000;
-      
-      // Check if this indicates multiple chickens
-      if (detectMultipleChickens(tagID, sessionDuration)) {
-        if (!multiChickenMode) {
-          // First time detecting multiple chickens
-          multiChickenMode = true;
-          lastMultiChickenDetection = millis(); // Record when we detected multiple chickens
-          singleChickenReadings = 0; // Reset counter
-          
-          Serial.println("*** MULTIPLE CHICKENS DETECTED! ***");
-          Serial.println("Rapid changes detected - cuddling chickens!");
-          Serial.println("Chickens seen: ");
-          for (int i = 0; i < chickenCount; i++) {
-            String info = getChickenInfo(detectedChickens[i]);
-            Serial.println("  " + info);
-          }
-          Serial.println("Status: MULTIPLE CHICKENS IN NEST");
-          Serial.println("===================");
-          
-          // Publish multi-chicken detection to MQTT
-          publishNestStatus("multiple", "multiple_chickens");
-          
-        } else {
-          // Already in multi-chicken mode, but show updated list
-          lastMultiChickenDetection = millis(); // Update timestamp for continued activity
-          singleChickenReadings = 0; // Reset single-chicken counter
-          
-          Serial.println("~ Multi-chicken activity continues ~");
-          Serial.println("Updated chicken list:");
-          for (int i = 0; i < chickenCount; i++) {
-            String info = getChickenInfo(detectedChickens[i]);
-            Serial.println("  " + info);
-          }
-          Serial.println("---");
-          
-          // Update MQTT with continued multi-chicken activity
-          publishNestStatus("multiple", "multiple_chickens");
-        }
-      } else {
-        // Normal chicken change - publish the previous chicken's visit first
-        String prevChickenInfo = getChickenInfo(currentChicken);
-        String newChickenInfo = getChickenInfo(tagID);
-        
-        Serial.println(">>> CHICKEN CHANGE! <<<");
-        Serial.println("Previous: " + prevChickenInfo + " (was there " + String(sessionDuration) + "s)");
-        Serial.println("New: " + newChickenInfo + " | Tag: " + tagID);
-        Serial.println("Status: OCCUPIED BY NEW CHICKEN");
-        Serial.println("===================");
-        
-        // Publish detailed chicken change event to MQTT
-        Chicken* prevChicken = findChickenByTag(currentChicken);
-        Chicken* newChicken = findChickenByTag(tagID);
-        
-        if (prevChicken && newChicken) {
-          // Publish the previous chicken's visit
-          publishChickenVisit(prevChicken->name, prevChicken->number, sessionDuration);
-          
-          // Publish the chicken change event  
-          publishChickenChange(prevChicken->name, newChicken->name, sessionDuration);
-          
-          // Update nest status with new chicken - IMMEDIATELY update occupant
-          publishNestStatus("occupied", newChicken->name);
-          
-          // Also publish directly to occupant topic to ensure it updates
-          mqtt.publish(topic_nest_occupant, newChicken->name.c_str());
-          
-          // NEW: Also update simple occupants format immediately
-          publishSimpleOccupants();
-          
-          Serial.println("MQTT: Updated occupant to " + newChicken->name);
-        }
-      }
-      
-      // Update to new chicken
-      currentChicken = tagID; // Store the full tag ID
-      chickenEnterTime = currentTime;
-      lastPresenceCheck = currentTime;
-      waitingForPresenceConfirmation = false; // Cancel waiting state
-    }
+  Serial.println("System Status: READY");
+  for (const NestConfig& nest : nestConfigs) {
+    Serial.printf("Monitoring: Nesting Box #%s (RFID on GPIO%d, reset on GPIO%d)\n", nest.tag, nest.rxPin, nest.resetPin);
   }
+  Serial.println("Smart Logic: Enter/Exit detection");
+  Serial.println("Reset Control: Enabled");
+  Serial.println("MQTT: Connecting in background (exponential backoff)");
+  Serial.println("Scoring: Active");
+  Serial.println("Note: EL125 is read-only (no RX pin)");
+  Serial.println("=====================================");
   
-  delay(100);
+  // The network task waits on the MQTT socket and this eventfd together
+  esp_vfs_eventfd_config_t eventfdConfig = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+  if (esp_vfs_eventfd_register(&eventfdConfig) == ESP_OK) {
+    networkWakeFd = eventfd(0, 0);
+  }
+  if (networkWakeFd < 0) {
+    Serial.printf("eventfd unavailable, the network task polls every %d ms\n", NETWORK_FALLBACK_POLL_MS);
+  }
+
+  // Start the pipeline: RFID -> tracker -> network
+  xTaskCreatePinnedToCore(trackerTask, "tracker", 8192, nullptr, TRACKER_TASK_PRIORITY, &trackerTaskHandle, TRACKER_TASK_CORE);
+  for (int i = 0; i < NEST_COUNT; i++) {
+    if (!rfidReady[i]) continue;
+    char name[16];
+    snprintf(name, sizeof(name), "rfid%s", nestConfigs[i].tag);
+    xTaskCreatePinnedToCore(rfidTask, name, 3072, &nests[i].reader, RFID_TASK_PRIORITY, nullptr, RFID_TASK_CORE);
+  }
+  xTaskCreatePinnedToCore(networkTask, "network", 4096, nullptr, NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE);
+  xTaskCreatePinnedToCore(logTask, "log", 3072, nullptr, LOG_TASK_PRIORITY, &logTaskHandle, LOG_TASK_CORE);
+  enableLightSleep();
+}
+
+void loop() {
+  // All work happens in the pipeline tasks
+  vTaskDelete(NULL);
 }
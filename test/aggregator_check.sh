@@ -0,0 +1,52 @@
+#!/bin/sh
+# Feeds test/fixtures/aggregator_input.txt to the aggregator with -i and compares the last
+# consolidated leaderboard and occupancy with test/fixtures/aggregator_expected.txt: visits merged
+# per chicken number across nests, JSON and MessagePack payloads both decoded, the occupancy map
+# and "where" built from single, multiple and empty statuses.
+#
+#   test/aggregator_check.sh                     # builds the aggregator environment first
+#   test/aggregator_check.sh path/to/aggregator  # uses an existing aggregator build
+
+cd "$(dirname "$0")/.." || exit 1
+
+if [ $# -gt 0 ]; then
+  program=$1
+else
+  pio run -e aggregator || exit 1
+  program=.pio/build/aggregator/program
+fi
+
+output=$(mktemp)
+log=$(mktemp)
+trap 'rm -f "$output" "$log"' EXIT
+status=0
+
+# Stored stats from an earlier run would be merged in
+if ! env -u CHICKEN_STATE_DIR "$program" -i test/fixtures/aggregator_input.txt > "$output" 2> "$log"; then
+  echo "FAIL aggregator exited with an error"
+  cat "$log"
+  exit 1
+fi
+
+for topic in chickens/coop/leaderboard chickens/coop/occupancy; do
+  expected=$(grep " $topic " test/fixtures/aggregator_expected.txt)
+  actual=$(grep " $topic " "$output" | tail -n 1)
+  if [ "$actual" = "$expected" ]; then
+    echo "PASS $topic"
+  else
+    echo "FAIL $topic"
+    echo "  expected: $expected"
+    echo "  actual:   $actual"
+    status=1
+  fi
+done
+
+if grep -q "7 visits, 16 statuses, 2 ignored" "$log"; then
+  echo "PASS counters: $(grep 'visits,' "$log")"
+else
+  echo "FAIL counters"
+  cat "$log"
+  status=1
+fi
+
+exit $status
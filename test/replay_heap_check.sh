@@ -0,0 +1,33 @@
+#!/bin/sh
+# Replays the traces in test/fixtures with -H: fails when the tracking/publish path allocates
+# from the heap after startup, or when allocations cannot be counted (needs glibc).
+#
+#   test/replay_heap_check.sh                 # builds the replay environment first
+#   test/replay_heap_check.sh path/to/replay  # uses an existing replay build
+
+cd "$(dirname "$0")/.." || exit 1
+
+if [ $# -gt 0 ]; then
+  program=$1
+else
+  pio run -e replay || exit 1
+  program=.pio/build/replay/program
+fi
+
+log=$(mktemp)
+trap 'rm -f "$log"' EXIT
+status=0
+
+for trace in test/fixtures/replay_trace.txt test/fixtures/replay_multi.txt; do
+  for options in "" "-p fixed" "-c visits,changes,status"; do
+    if "$program" -H $options "$trace" > /dev/null 2> "$log"; then
+      echo "PASS $trace $options: $(grep 'heap allocations' "$log")"
+    else
+      echo "FAIL $trace $options"
+      cat "$log"
+      status=1
+    fi
+  done
+done
+
+exit $status
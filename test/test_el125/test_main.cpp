@@ -0,0 +1,98 @@
+// EL125 frames against the built-in flock: every database ID must decode from the frame
+// the reader sends for it and be found in the registry.
+//   pio test -e native -f test_el125
+
+#include <unity.h>
+#include <El125Parser.h>
+#include <ChickenDatabase.h>
+#include <string.h>
+
+static El125Parser::Result feedAll(El125Parser& parser, const uint8_t* bytes, size_t length) {
+  El125Parser::Result result = El125Parser::NONE;
+  for (size_t i = 0; i < length; i++) {
+    El125Parser::Result r = parser.feed(bytes[i]);
+    if (r != El125Parser::NONE) result = r;
+  }
+  return result;
+}
+
+static El125Parser::Result feedText(El125Parser& parser, const char* payload) {
+  El125Parser::Result result = parser.feed(EL125_STX);
+  feedAll(parser, (const uint8_t*)payload, strlen(payload));
+  El125Parser::Result end = parser.feed(EL125_ETX);
+  return end != El125Parser::NONE ? end : result;
+}
+
+void setUp() {
+  loadDefaultChickens();
+}
+
+void tearDown() {}
+
+// Lady Kluck, written out by hand: data 02 00 3E 98 C8, checksum 02^00^3E^98^C8 = 6C
+void test_known_frame() {
+  El125Parser parser;
+  TEST_ASSERT_EQUAL(El125Parser::FRAME, feedText(parser, "02003E98C86C"));
+  TEST_ASSERT_EQUAL_HEX64(0x2003E98C8ULL, parser.tag());
+  const Chicken* chicken = findChickenByTag(parser.tag());
+  TEST_ASSERT_NOT_NULL(chicken);
+  TEST_ASSERT_EQUAL_INT(1, chicken->number);
+}
+
+void test_every_database_tag_decodes() {
+  TEST_ASSERT_TRUE(chickenRegistry.count() > 0);
+  for (ChickenHandle handle = 0; handle < MAX_CHICKENS; handle++) {
+    const Chicken* chicken = chickenByHandle(handle);
+    if (!chicken) continue;
+
+    uint8_t frame[EL125_FRAME_LEN];
+    El125Parser parser;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(El125Parser::FRAME, feedAll(parser, frame, encodeEl125Frame(chicken->tagID, frame)),
+                                  chicken->name);
+    TEST_ASSERT_EQUAL_HEX64_MESSAGE(chicken->tagID, parser.tag(), chicken->name);
+    TEST_ASSERT_TRUE_MESSAGE(findChickenByTag(parser.tag()) == chicken, chicken->name);
+  }
+}
+
+// Readers that leave out the checksum digits send the 10 data digits only
+void test_frame_without_checksum() {
+  El125Parser parser;
+  TEST_ASSERT_EQUAL(El125Parser::FRAME, feedText(parser, "20032D5A4A"));
+  TEST_ASSERT_EQUAL_HEX64(0x20032D5A4AULL, parser.tag());
+  TEST_ASSERT_NOT_NULL(findChickenByTag(parser.tag()));
+}
+
+void test_bad_checksum_rejected() {
+  El125Parser parser;
+  TEST_ASSERT_EQUAL(El125Parser::REJECTED, feedText(parser, "02003E98C86D"));
+  // The 12 digits of the old text ID are not a valid frame either
+  TEST_ASSERT_EQUAL(El125Parser::REJECTED, feedText(parser, "0002003E98C8"));
+  TEST_ASSERT_EQUAL_UINT32(0, parser.framesAccepted());
+  TEST_ASSERT_EQUAL_UINT32(2, parser.framesRejected());
+}
+
+void test_bad_length_rejected() {
+  El125Parser parser;
+  TEST_ASSERT_EQUAL(El125Parser::REJECTED, feedText(parser, "2003E98C8"));
+  TEST_ASSERT_EQUAL(El125Parser::REJECTED, feedText(parser, "02003E98C86C0"));
+}
+
+// CR/LF inside the frame and noise between frames are skipped
+void test_noise_skipped() {
+  El125Parser parser;
+  static const uint8_t bytes[] = { 'x', 0xFF, EL125_STX, '0', '2', '0', '0', '3', 'E', '9', '8', 'C', '8',
+                                   '6', 'C', '\r', '\n', EL125_ETX };
+  TEST_ASSERT_EQUAL(El125Parser::FRAME, feedAll(parser, bytes, sizeof(bytes)));
+  TEST_ASSERT_EQUAL_HEX64(0x2003E98C8ULL, parser.tag());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_known_frame);
+  RUN_TEST(test_every_database_tag_decodes);
+  RUN_TEST(test_frame_without_checksum);
+  RUN_TEST(test_bad_checksum_rejected);
+  RUN_TEST(test_bad_length_rejected);
+  RUN_TEST(test_noise_skipped);
+  return UNITY_END();
+}
@@ -0,0 +1,50 @@
+// Network task sleep: the keepalive deadline that PubSubClient's loop() pings at.
+//   pio test -e native -f test_keepalive
+
+#include <unity.h>
+#include <ConnectionManager.h>
+
+#define KEEPALIVE_MS 15000UL
+
+void setUp() {}
+void tearDown() {}
+
+void test_idle_connection_sleeps_until_ping() {
+  KeepaliveClock keepalive(KEEPALIVE_MS);
+  keepalive.connected(1000);
+  TEST_ASSERT_EQUAL_UINT32(KEEPALIVE_MS + 1, keepalive.msUntilPing(1000));
+  TEST_ASSERT_FALSE(keepalive.pingDue(1000 + KEEPALIVE_MS));
+  TEST_ASSERT_TRUE(keepalive.pingDue(1000 + KEEPALIVE_MS + 1));
+  TEST_ASSERT_EQUAL_UINT32(0, keepalive.msUntilPing(1000 + KEEPALIVE_MS + 1));
+
+  // After the ping both directions count from it; the reply is due within one period
+  keepalive.pinged(20000);
+  TEST_ASSERT_EQUAL_UINT32(KEEPALIVE_MS + 1, keepalive.msUntilPing(20000));
+}
+
+// Publishing alone doesn't postpone the ping: the client also pings when nothing came in
+void test_oldest_direction_sets_deadline() {
+  KeepaliveClock keepalive(KEEPALIVE_MS);
+  keepalive.connected(0);
+  keepalive.sent(10000);
+  TEST_ASSERT_EQUAL_UINT32(KEEPALIVE_MS + 1 - 10000, keepalive.msUntilPing(10000));
+  keepalive.received(12000);
+  TEST_ASSERT_EQUAL_UINT32(KEEPALIVE_MS + 1 - 2000, keepalive.msUntilPing(12000));
+  TEST_ASSERT_TRUE(keepalive.pingDue(10000 + KEEPALIVE_MS + 1));
+}
+
+void test_millis_wrap() {
+  KeepaliveClock keepalive(KEEPALIVE_MS);
+  unsigned long start = (unsigned long)-5000;
+  keepalive.connected(start);
+  TEST_ASSERT_EQUAL_UINT32(KEEPALIVE_MS + 1 - 10000, keepalive.msUntilPing(start + 10000));
+  TEST_ASSERT_FALSE(keepalive.pingDue(start + 10000));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_idle_connection_sleeps_until_ping);
+  RUN_TEST(test_oldest_direction_sets_deadline);
+  RUN_TEST(test_millis_wrap);
+  return UNITY_END();
+}
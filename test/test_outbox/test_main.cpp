@@ -0,0 +1,160 @@
+// Store-and-forward: outbox records leave only once the publisher confirms delivery.
+//   pio test -e native -f test_outbox
+
+#include <unity.h>
+#include <NestTracker.h>
+#include <string.h>
+
+class TestClock : public HalClock {
+public:
+  unsigned long millis() override { return now; }
+  void delay(unsigned long ms) override { now += ms; }
+  unsigned long now = 1000;
+};
+
+class TestResetPin : public HalResetPin {
+public:
+  void write(bool) override {}
+};
+
+class TestLog : public HalLog {
+public:
+  void println(const char*) override {}
+};
+
+// Like the firmware's queued publisher: confirmed messages are only reported when the test says so
+class DeferredPublisher : public HalPublisher {
+public:
+  bool connected() override { return true; }
+  bool publish(const char*, const char*) override { return true; }
+  bool publish(const char*, const uint8_t*, size_t) override { return true; }
+  bool publishConfirmed(const char*, const uint8_t*, size_t, bool, DeliveryReceipt& receipt) override {
+    if (pending == MAX_PENDING) return false;
+    receipts[pending++] = &receipt;
+    sent++;
+    return true;
+  }
+
+  // Report the queued messages in order; the first `failures` of them fail
+  void report(int failures) {
+    for (int i = 0; i < pending; i++) {
+      DeliveryReceipt* receipt = receipts[i];
+      if (i < failures || receipt->blocked.load()) {
+        receipt->blocked.store(true);
+        receipt->failed.fetch_add(1);
+      } else {
+        receipt->delivered.fetch_add(1);
+      }
+    }
+    pending = 0;
+  }
+
+  static const int MAX_PENDING = 16;
+  DeliveryReceipt* receipts[MAX_PENDING];
+  int pending = 0;
+  int sent = 0;
+};
+
+static TestClock testClock;
+static TestResetPin resetPin;
+static DeferredPublisher publisher;
+static TestLog testLog;
+static NestTracker tracker;
+
+void setUp() {}
+void tearDown() {}
+
+// One visit by the first built-in chicken: read for a while, then gone until the exit is seen
+static void visit() {
+  TagId tag = chickenByHandle(0)->tagID;
+  uint32_t exits = tracker.trackingMetrics().exits;
+  for (int i = 0; i < 10; i++) {
+    tracker.handleTag(tag, testClock.now);
+    testClock.delay(1000);
+    tracker.update();
+  }
+  for (int i = 0; i < 6000 && tracker.trackingMetrics().exits == exits; i++) {
+    testClock.delay(100);
+    tracker.update();
+  }
+  TEST_ASSERT_EQUAL_UINT32(exits + 1, tracker.trackingMetrics().exits);
+}
+
+// Run the tracker past the next outbox batch interval
+static void nextBatch() {
+  testClock.delay(OUTBOX_BATCH_INTERVAL_MS);
+  tracker.update();
+}
+
+void test_failed_visit_is_sent_again() {
+  Hal hal = { &testClock, nullptr, &resetPin, &publisher, &testLog, nullptr, nullptr };
+  tracker.begin(hal, "T");
+
+  visit();
+  nextBatch();
+  TEST_ASSERT_EQUAL_INT(1, publisher.sent);
+  TEST_ASSERT_EQUAL_INT(1, publisher.pending);
+
+  // Not reported yet: still in flight, not sent twice
+  nextBatch();
+  TEST_ASSERT_EQUAL_INT(1, publisher.sent);
+
+  // The transport lost it: it goes out again
+  publisher.report(1);
+  nextBatch();
+  nextBatch();
+  TEST_ASSERT_EQUAL_INT(2, publisher.sent);
+
+  // Delivered: nothing left to send
+  publisher.report(0);
+  nextBatch();
+  nextBatch();
+  TEST_ASSERT_EQUAL_INT(2, publisher.sent);
+  TEST_ASSERT_EQUAL_INT(0, publisher.pending);
+}
+
+// After a failure the rest of the batch is held back and resent in the original order
+void test_failure_resends_whole_batch() {
+  int before = publisher.sent;
+  visit();
+  visit();
+  visit();
+  nextBatch();
+  TEST_ASSERT_EQUAL_INT(before + 3, publisher.sent);
+
+  publisher.report(1); // First fails, the other two are held back
+  nextBatch();
+  TEST_ASSERT_EQUAL_INT(before + 6, publisher.sent);
+
+  publisher.report(0);
+  nextBatch();
+  nextBatch();
+  TEST_ASSERT_EQUAL_INT(before + 6, publisher.sent);
+}
+
+// RAM full: the oldest record that is not in flight is the one dropped
+void test_outbox_drops_oldest_unsent() {
+  Outbox outbox;
+  OutboxRecord record = {};
+  for (uint32_t i = 0; i < OUTBOX_CAPACITY; i++) {
+    record.timestampMs = i;
+    outbox.push(record);
+  }
+  outbox.markSent();
+  record.timestampMs = OUTBOX_CAPACITY;
+  outbox.push(record);
+
+  TEST_ASSERT_EQUAL_UINT32(1, outbox.droppedCount());
+  TEST_ASSERT_EQUAL_UINT32(2, outbox.next()->timestampMs);
+  outbox.pop(); // The in-flight record 0 is delivered
+  TEST_ASSERT_EQUAL_UINT32(0, outbox.inFlightCount());
+  TEST_ASSERT_EQUAL_UINT32(2, outbox.next()->timestampMs);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_failed_visit_is_sent_again);
+  RUN_TEST(test_failure_resends_whole_batch);
+  RUN_TEST(test_outbox_drops_oldest_unsent);
+  return UNITY_END();
+}
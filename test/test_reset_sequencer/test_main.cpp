@@ -0,0 +1,61 @@
+// Which frames the reader reset sequence lets through, judged by their read timestamps.
+//   pio test -e native -f test_reset_sequencer
+
+#include <unity.h>
+#include <ResetSequencer.h>
+
+class TestPin : public HalResetPin {
+public:
+  void write(bool high) override { level = high; }
+  bool level = true;
+};
+
+static TestPin pin;
+static ResetSequencer sequencer(200, 1000);
+
+void setUp() {
+  sequencer = ResetSequencer(200, 1000);
+  sequencer.begin(&pin);
+}
+
+void tearDown() {}
+
+void test_phases() {
+  sequencer.start(1000);
+  TEST_ASSERT_FALSE(pin.level);
+  TEST_ASSERT_EQUAL(ResetSequencer::NO_EVENT, sequencer.update(1100));
+  TEST_ASSERT_EQUAL(ResetSequencer::RELEASED, sequencer.update(1200));
+  TEST_ASSERT_TRUE(pin.level);
+  TEST_ASSERT_EQUAL(ResetSequencer::NO_EVENT, sequencer.update(2100));
+  TEST_ASSERT_EQUAL(ResetSequencer::SETTLED, sequencer.update(2200));
+  TEST_ASSERT_FALSE(sequencer.busy());
+}
+
+void test_reads_while_held_low_rejected() {
+  sequencer.start(1000);
+  TEST_ASSERT_FALSE(sequencer.acceptsReadAt(1000, true));
+  TEST_ASSERT_FALSE(sequencer.acceptsReadAt(1150, false));
+  sequencer.update(1200);
+  TEST_ASSERT_FALSE(sequencer.acceptsReadAt(1199, true));
+  TEST_ASSERT_TRUE(sequencer.acceptsReadAt(1200, true)); // Restarted reader, settling
+  sequencer.update(2200);
+  TEST_ASSERT_TRUE(sequencer.acceptsReadAt(2500, true));
+}
+
+// A frame read before the reset but handled after it can't answer the probe
+void test_read_queued_before_probe() {
+  sequencer.start(1000);
+  TEST_ASSERT_FALSE(sequencer.acceptsReadAt(990, true));
+  TEST_ASSERT_TRUE(sequencer.acceptsReadAt(990, false));
+  sequencer.update(1200);
+  sequencer.update(2200);
+  TEST_ASSERT_FALSE(sequencer.acceptsReadAt(990, true));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_phases);
+  RUN_TEST(test_reads_while_held_low_rejected);
+  RUN_TEST(test_read_queued_before_probe);
+  return UNITY_END();
+}
@@ -0,0 +1,260 @@
+// Visit history: segment rotation, indexed range queries, batched writes and the MQTT query.
+//   pio test -e native -f test_visit_log
+
+#include <unity.h>
+#include <NestTracker.h>
+#include <PublishQueue.h>
+#include <string.h>
+#include <vector>
+
+// Segments in RAM, counting the file accesses a query makes
+class MemoryVisitLogFiles : public VisitLogFiles {
+public:
+  bool range(uint32_t& first, uint32_t& last) override {
+    bool found = false;
+    for (uint32_t id = 0; id < segments.size(); id++) {
+      if (!present[id]) continue;
+      if (!found) first = id;
+      last = id;
+      found = true;
+    }
+    return found;
+  }
+  uint32_t size(uint32_t segment) override { return exists(segment) ? segments[segment].size() : 0; }
+  size_t read(uint32_t segment, uint32_t offset, void* data, size_t size) override {
+    reads++;
+    if (!exists(segment) || offset >= segments[segment].size()) return 0;
+    size_t available = segments[segment].size() - offset;
+    if (size > available) size = available;
+    memcpy(data, segments[segment].data() + offset, size);
+    return size;
+  }
+  bool append(uint32_t segment, const void* data, size_t size) override {
+    appends++;
+    if (segment >= segments.size()) {
+      segments.resize(segment + 1);
+      present.resize(segment + 1, false);
+    }
+    present[segment] = true;
+    const uint8_t* bytes = (const uint8_t*)data;
+    segments[segment].insert(segments[segment].end(), bytes, bytes + size);
+    return true;
+  }
+  bool remove(uint32_t segment) override {
+    if (!exists(segment)) return false;
+    segments[segment].clear();
+    present[segment] = false;
+    return true;
+  }
+
+  bool exists(uint32_t segment) const { return segment < segments.size() && present[segment]; }
+  int count() const {
+    int n = 0;
+    for (bool p : present) n += p;
+    return n;
+  }
+
+  std::vector<std::vector<uint8_t>> segments;
+  std::vector<bool> present;
+  int reads = 0;
+  int appends = 0;
+};
+
+struct Collected {
+  uint32_t count;
+  uint32_t firstTime;
+  uint32_t lastTime;
+};
+
+static bool collect(const VisitLogRecord& record, void* context) {
+  Collected& collected = *static_cast<Collected*>(context);
+  if (collected.count == 0) collected.firstTime = record.time;
+  collected.lastTime = record.time;
+  collected.count++;
+  return true;
+}
+
+static void appendVisits(VisitLog& log, uint32_t firstTime, uint32_t count, ChickenHandle chicken = 0) {
+  for (uint32_t i = 0; i < count; i++) {
+    VisitLogRecord record = {};
+    record.time = firstTime + i;
+    record.duration = 60;
+    record.chicken = chicken;
+    record.other = NO_CHICKEN;
+    record.kind = OUTBOX_VISIT;
+    TEST_ASSERT_TRUE(log.append(record, 0));
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Writes wait for a full batch (or the flush interval) and then go out as one append
+void test_appends_are_batched() {
+  MemoryVisitLogFiles files;
+  VisitLog log;
+  TEST_ASSERT_TRUE(log.begin(&files));
+
+  appendVisits(log, 100, VISIT_LOG_WRITE_BATCH - 1);
+  TEST_ASSERT_EQUAL_INT(0, files.appends);
+  TEST_ASSERT_FALSE(log.flushDue(VISIT_LOG_FLUSH_INTERVAL_MS - 1));
+  TEST_ASSERT_TRUE(log.flushDue(VISIT_LOG_FLUSH_INTERVAL_MS));
+  TEST_ASSERT_EQUAL_UINT32(VISIT_LOG_WRITE_BATCH - 1, log.size());
+
+  appendVisits(log, 200, 1);
+  TEST_ASSERT_TRUE(log.flushDue(0));
+  appendVisits(log, 300, 1); // Buffer full: the batch is written first
+  TEST_ASSERT_EQUAL_INT(1, files.appends);
+  TEST_ASSERT_EQUAL_UINT32(VISIT_LOG_WRITE_BATCH * sizeof(VisitLogRecord), files.size(0));
+
+  // Queries see the buffered record too
+  Collected collected = {};
+  TEST_ASSERT_EQUAL_UINT32(VISIT_LOG_WRITE_BATCH + 1, log.query(0, UINT32_MAX, NO_CHICKEN, collect, &collected));
+  TEST_ASSERT_EQUAL_UINT32(300, collected.lastTime);
+}
+
+// A full log drops its oldest segment; the index survives a reboot
+void test_rotation_drops_oldest_segment() {
+  MemoryVisitLogFiles files;
+  VisitLog log;
+  log.begin(&files);
+
+  const uint32_t capacity = VISIT_LOG_MAX_SEGMENTS * VISIT_LOG_SEGMENT_RECORDS;
+  appendVisits(log, 1000, capacity + VISIT_LOG_SEGMENT_RECORDS / 2);
+  log.flush();
+  TEST_ASSERT_EQUAL_INT(VISIT_LOG_MAX_SEGMENTS, files.count());
+  TEST_ASSERT_FALSE(files.exists(0));
+  TEST_ASSERT_EQUAL_UINT32(capacity - VISIT_LOG_SEGMENT_RECORDS / 2, log.size());
+
+  Collected collected = {};
+  log.query(0, UINT32_MAX, NO_CHICKEN, collect, &collected);
+  TEST_ASSERT_EQUAL_UINT32(log.size(), collected.count);
+  TEST_ASSERT_EQUAL_UINT32(1000 + VISIT_LOG_SEGMENT_RECORDS, collected.firstTime);
+
+  VisitLog rebooted;
+  rebooted.begin(&files);
+  TEST_ASSERT_EQUAL_UINT32(log.size(), rebooted.size());
+  TEST_ASSERT_EQUAL_UINT32(log.lastTime(), rebooted.lastTime());
+}
+
+// A range inside one segment is found by binary search, not by reading the log from the start
+void test_indexed_range_query() {
+  MemoryVisitLogFiles files;
+  VisitLog log;
+  log.begin(&files);
+  appendVisits(log, 1000, 4 * VISIT_LOG_SEGMENT_RECORDS);
+  log.flush();
+
+  uint32_t from = 1000 + 2 * VISIT_LOG_SEGMENT_RECORDS + 300;
+  files.reads = 0;
+  Collected collected = {};
+  TEST_ASSERT_EQUAL_UINT32(40, log.query(from, from + 40, NO_CHICKEN, collect, &collected));
+  TEST_ASSERT_EQUAL_UINT32(from, collected.firstTime);
+  TEST_ASSERT_EQUAL_UINT32(from + 39, collected.lastTime);
+  TEST_ASSERT_TRUE(files.reads <= 16); // ~10 probes plus a few chunks
+
+  // A range across a segment boundary
+  from = 1000 + VISIT_LOG_SEGMENT_RECORDS - 5;
+  collected = {};
+  TEST_ASSERT_EQUAL_UINT32(10, log.query(from, from + 10, NO_CHICKEN, collect, &collected));
+  TEST_ASSERT_EQUAL_UINT32(from + 9, collected.lastTime);
+}
+
+void test_query_for_one_chicken() {
+  MemoryVisitLogFiles files;
+  VisitLog log;
+  log.begin(&files);
+  appendVisits(log, 1000, 20, 0);
+  appendVisits(log, 2000, 5, 3);
+  VisitLogRecord change = {};
+  change.time = 3000;
+  change.chicken = 1;
+  change.other = 3;
+  change.kind = OUTBOX_CHANGE;
+  log.append(change, 0);
+
+  Collected collected = {};
+  TEST_ASSERT_EQUAL_UINT32(6, log.query(0, UINT32_MAX, 3, collect, &collected));
+  TEST_ASSERT_EQUAL_UINT32(2000, collected.firstTime);
+  TEST_ASSERT_EQUAL_UINT32(3000, collected.lastTime);
+}
+
+class TestClock : public HalClock {
+public:
+  unsigned long millis() override { return now; }
+  void delay(unsigned long ms) override { now += ms; }
+  uint32_t epochSeconds() override { return 1760000000 + now / 1000; }
+  unsigned long now = 1000;
+};
+
+class TestResetPin : public HalResetPin {
+public:
+  void write(bool) override {}
+};
+
+class TestLog : public HalLog {
+public:
+  void println(const char*) override {}
+};
+
+class RecordingPublisher : public HalPublisher {
+public:
+  bool connected() override { return true; }
+  bool publish(const char* topic, const char* payload) override {
+    if (strcmp(topic, "chickens/nestT/visits/history") == 0) {
+      replies++;
+      snprintf(reply, sizeof(reply), "%s", payload);
+    }
+    return true;
+  }
+  bool publish(const char*, const uint8_t*, size_t) override { return true; }
+
+  int replies = 0;
+  char reply[PUBLISH_PAYLOAD_MAX];
+};
+
+// A visit ends up in the reply to a query on the request topic
+void test_history_request_answered() {
+  static TestClock clock;
+  static TestResetPin resetPin;
+  static RecordingPublisher publisher;
+  static TestLog testLog;
+  static MemoryVisitLogFiles files;
+  static NestTracker tracker;
+  Hal hal = { &clock, nullptr, &resetPin, &publisher, &testLog, nullptr, nullptr };
+  tracker.begin(hal, "T", nullptr, &files);
+  TEST_ASSERT_EQUAL_STRING("chickens/nestT/visits/get", tracker.visitHistoryRequestTopic());
+
+  TagId tag = chickenByHandle(0)->tagID;
+  for (int i = 0; i < 10; i++) {
+    tracker.handleTag(tag, clock.now);
+    clock.delay(1000);
+    tracker.update();
+  }
+  for (int i = 0; i < 6000 && tracker.trackingMetrics().exits == 0; i++) {
+    clock.delay(100);
+    tracker.update();
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, tracker.trackingMetrics().exits);
+  TEST_ASSERT_EQUAL_UINT32(1, tracker.visits().size());
+
+  const char* request = "{\"chicken\":1}";
+  TEST_ASSERT_TRUE(tracker.requestVisitHistory(request, strlen(request)));
+  TEST_ASSERT_FALSE(tracker.requestVisitHistory(request, strlen(request))); // One at a time
+  TEST_ASSERT_EQUAL_UINT32(0, tracker.idleMs());
+  tracker.update();
+  TEST_ASSERT_EQUAL_INT(1, publisher.replies);
+  TEST_ASSERT_NOT_NULL(strstr(publisher.reply, "\"records\":[["));
+  TEST_ASSERT_NULL(strstr(publisher.reply, "\"next\""));
+  TEST_ASSERT_TRUE(tracker.requestVisitHistory(request, strlen(request)));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_appends_are_batched);
+  RUN_TEST(test_rotation_drops_oldest_segment);
+  RUN_TEST(test_indexed_range_query);
+  RUN_TEST(test_query_for_one_chicken);
+  RUN_TEST(test_history_request_answered);
+  return UNITY_END();
+}